@@ -0,0 +1,456 @@
+#include "micropython_engine.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if MP_EMBED_NAN_BOXING
+#define BENCH_OBJECT_REPR "nan-boxing"
+#else
+#define BENCH_OBJECT_REPR "boxed-float"
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    size_t iterations = 1000;   // Samples per benchmark
+    bool json = false;          // Machine-readable output
+    std::string filter;         // Only run benchmarks whose name contains this
+};
+
+/**
+ * Latency distribution and throughput of one benchmark
+ */
+struct Result {
+    std::string name;
+    size_t ops = 0;             // Operations timed
+    double p50_us = 0;          // Per-operation latency percentiles
+    double p99_us = 0;
+    double mean_us = 0;
+    double ops_per_sec = 0;
+    double allocs_per_op = -1;  // Heap allocations per operation, < 0 if not counted
+    std::string skipped;        // Reason the benchmark did not run
+};
+
+std::string jsonString(const std::string& text) {
+    std::string result = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            result += escaped;
+        } else {
+            result += c;
+        }
+    }
+    return result + "\"";
+}
+
+/**
+ * Times operations and collects the results
+ */
+class Runner {
+public:
+    explicit Runner(const Options& options) : options_(options) {}
+
+    /**
+     * Count heap allocations per operation in the following benchmarks
+     * @param counter Returns the allocations made so far, or nullptr to stop counting
+     */
+    void countAllocations(std::function<uint64_t()> counter) {
+        allocations_ = std::move(counter);
+    }
+
+    bool selected(const std::string& name) const {
+        return options_.filter.empty() || name.find(options_.filter) != std::string::npos;
+    }
+
+    /**
+     * Time an operation
+     * Each sample runs it batch times so that clock reads do not dominate
+     * cheap operations; latencies are per operation.
+     * @param name Benchmark name
+     * @param batch Operations per sample
+     * @param op Runs one operation, false on failure
+     * @param setup Runs untimed before every sample
+     * @return false if an operation failed (the benchmark is dropped)
+     */
+    template <typename Op, typename Setup>
+    bool run(const std::string& name, size_t batch, Op op, Setup setup) {
+        if (!selected(name)) {
+            return true;
+        }
+        std::vector<double> samples;
+        samples.reserve(options_.iterations);
+        size_t warmup = std::max<size_t>(options_.iterations / 10, 1);
+        uint64_t allocations = allocations_ ? allocations_() : 0;
+        for (size_t i = 0; i < warmup + options_.iterations; i++) {
+            setup();
+            Clock::time_point start = Clock::now();
+            for (size_t j = 0; j < batch; j++) {
+                if (!op()) {
+                    return false;
+                }
+            }
+            double elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+            if (i >= warmup) {
+                samples.push_back(elapsed / batch);
+            }
+        }
+
+        Result result;
+        result.name = name;
+        result.ops = samples.size() * batch;
+        double total = 0;
+        for (double sample : samples) {
+            total += sample;
+        }
+        std::sort(samples.begin(), samples.end());
+        result.mean_us = total / samples.size();
+        result.p50_us = samples[samples.size() / 2];
+        result.p99_us = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+        result.ops_per_sec = total > 0 ? samples.size() * 1e6 / total : 0;
+        if (allocations_) {
+            // Setup runs untimed but is counted; keep it allocation free
+            result.allocs_per_op = static_cast<double>(allocations_() - allocations) / ((warmup + options_.iterations) * batch);
+        }
+        results_.push_back(result);
+        return true;
+    }
+
+    template <typename Op>
+    bool run(const std::string& name, size_t batch, Op op) {
+        return run(name, batch, op, [] {});
+    }
+
+    /**
+     * Record a benchmark that cannot run in this build
+     */
+    void skip(const std::string& name, const std::string& reason) {
+        if (selected(name)) {
+            Result result;
+            result.name = name;
+            result.skipped = reason;
+            results_.push_back(result);
+        }
+    }
+
+    void print() const {
+        if (options_.json) {
+            std::cout << "{\n  \"object_repr\": " << jsonString(BENCH_OBJECT_REPR)
+                      << ",\n  \"iterations\": " << options_.iterations << ",\n  \"results\": [";
+            for (size_t i = 0; i < results_.size(); i++) {
+                const Result& result = results_[i];
+                std::cout << (i ? ",\n" : "\n") << "    {\"name\": " << jsonString(result.name);
+                if (!result.skipped.empty()) {
+                    std::cout << ", \"skipped\": " << jsonString(result.skipped) << "}";
+                    continue;
+                }
+                char numbers[256];
+                std::snprintf(numbers, sizeof(numbers),
+                              ", \"ops\": %zu, \"p50_us\": %.3f, \"p99_us\": %.3f, \"mean_us\": %.3f, \"ops_per_sec\": %.1f}",
+                              result.ops, result.p50_us, result.p99_us, result.mean_us, result.ops_per_sec);
+                std::string entry = numbers;
+                if (result.allocs_per_op >= 0) {
+                    std::snprintf(numbers, sizeof(numbers), ", \"allocs_per_op\": %.2f}", result.allocs_per_op);
+                    entry.replace(entry.size() - 1, 1, numbers);
+                }
+                std::cout << entry;
+            }
+            std::cout << "\n  ]\n}" << std::endl;
+            return;
+        }
+
+        std::printf("object representation: %s\n", BENCH_OBJECT_REPR);
+        std::printf("%-32s %12s %12s %12s %14s %10s\n", "benchmark", "p50 (us)", "p99 (us)", "mean (us)", "ops/sec",
+                    "allocs/op");
+        for (const Result& result : results_) {
+            if (!result.skipped.empty()) {
+                std::printf("%-32s skipped: %s\n", result.name.c_str(), result.skipped.c_str());
+                continue;
+            }
+            std::printf("%-32s %12.3f %12.3f %12.3f %14.1f", result.name.c_str(),
+                        result.p50_us, result.p99_us, result.mean_us, result.ops_per_sec);
+            if (result.allocs_per_op >= 0) {
+                std::printf(" %10.2f", result.allocs_per_op);
+            } else {
+                std::printf(" %10s", "-");
+            }
+            std::printf("\n");
+        }
+    }
+
+private:
+    const Options& options_;
+    std::vector<Result> results_;
+    std::function<uint64_t()> allocations_;
+};
+
+// A running engine for one group of benchmarks
+bool start(MicroPythonEngine& engine, const MicroPythonConfig& config) {
+    if (!engine.initialize(config)) {
+        std::cerr << "Failed to initialize engine: " << engine.getLastError() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void benchLifecycle(Runner& runner) {
+    MicroPythonConfig config;
+    MicroPythonEngine engine;
+    runner.run("initialize", 1,
+               [&] { return engine.initialize(config); },
+               [&] { engine.shutdown(); });
+    runner.run("shutdown", 1,
+               [&] { engine.shutdown(); return true; },
+               [&] {
+                   if (!engine.isInitialized()) {
+                       engine.initialize(config);
+                   }
+               });
+}
+
+void benchExecute(Runner& runner) {
+    MicroPythonConfig config;
+    MicroPythonEngine cached;
+    if (start(cached, config)) {
+        runner.run("execute_string/cached", 100, [&] { return cached.executeString("x = 1 + 2"); });
+    }
+
+    config.code_cache_size = 0;
+    MicroPythonEngine uncached;
+    if (start(uncached, config)) {
+        runner.run("execute_string/uncached", 100, [&] { return uncached.executeString("x = 1 + 2"); });
+    }
+}
+
+void benchProfiler(Runner& runner) {
+    // Same as execute_string/cached while sampling every millisecond; the
+    // difference is the profiler's overhead
+    MicroPythonEngine engine;
+    if (!start(engine, MicroPythonConfig())) {
+        return;
+    }
+    if (!engine.startProfiling(std::chrono::milliseconds(1))) {
+        runner.skip("profiler/execute_string cached", engine.getLastError());
+        return;
+    }
+    runner.run("profiler/execute_string cached", 100, [&] { return engine.executeString("x = 1 + 2"); });
+    engine.stopProfiling();
+}
+
+void benchCall(Runner& runner) {
+    MicroPythonEngine engine;
+    if (!start(engine, MicroPythonConfig())) {
+        return;
+    }
+    auto call = [&] {
+        try {
+            return engine.call<int>("abs", -7) == 7;
+        } catch (const MicroPythonException&) {
+            return false;
+        }
+    };
+    if (!runner.run("call/abs(int)", 100, call)) {
+        runner.skip("call/abs(int)", engine.getLastError());
+    }
+    auto callString = [&] {
+        try {
+            return engine.call<std::string>("str", 12345).size() == 5;
+        } catch (const MicroPythonException&) {
+            return false;
+        }
+    };
+    if (!runner.run("call/str(int)", 100, callString)) {
+        runner.skip("call/str(int)", engine.getLastError());
+    }
+
+    // Per item of a batch (one VM entry for all items)
+    std::vector<int> inputs(100, -7);
+    std::vector<int> outputs;
+    size_t item = 0;
+    auto batch = [&] {
+        if (item++ % inputs.size() == 0) {
+            try {
+                return engine.callBatch("abs", inputs, outputs).empty();
+            } catch (const MicroPythonException&) {
+                return false;
+            }
+        }
+        return true;
+    };
+    if (!runner.run("call_batch/abs(int) per item", inputs.size(), batch)) {
+        runner.skip("call_batch/abs(int) per item", engine.getLastError());
+    }
+}
+
+void benchFloat(Runner& runner) {
+    MicroPythonEngine engine;
+    if (!start(engine, MicroPythonConfig())) {
+        return;
+    }
+    runner.countAllocations([&] { return engine.getHeapStats().allocations; });
+
+    // Every argument and result is a float
+    auto call = [&] {
+        try {
+            return engine.call<double>("abs", -1.5) == 1.5;
+        } catch (const MicroPythonException&) {
+            return false;
+        }
+    };
+    if (!runner.run("float/abs(float)", 100, call)) {
+        runner.skip("float/abs(float)", engine.getLastError());
+    }
+
+    std::vector<double> inputs(100);
+    for (size_t i = 0; i < inputs.size(); i++) {
+        inputs[i] = -0.5 * static_cast<double>(i);
+    }
+    std::vector<double> outputs;
+    size_t item = 0;
+    auto batch = [&] {
+        if (item++ % inputs.size() == 0) {
+            try {
+                return engine.callBatch("abs", inputs, outputs).empty();
+            } catch (const MicroPythonException&) {
+                return false;
+            }
+        }
+        return true;
+    };
+    if (!runner.run("float/call_batch abs per item", inputs.size(), batch)) {
+        runner.skip("float/call_batch abs per item", engine.getLastError());
+    }
+
+    // A list of floats in, a float out
+    auto sum = [&] {
+        try {
+            return engine.call<double>("sum", inputs) < 0;
+        } catch (const MicroPythonException&) {
+            return false;
+        }
+    };
+    if (!runner.run("float/sum(list of 100)", 10, sum)) {
+        runner.skip("float/sum(list of 100)", engine.getLastError());
+    }
+    runner.countAllocations(nullptr);
+}
+
+void benchGc(Runner& runner) {
+    for (size_t heapKb : {64, 1024, 16 * 1024}) {
+        MicroPythonConfig config;
+        config.heap_size = heapKb * 1024;
+        MicroPythonEngine engine;
+        if (!start(engine, config)) {
+            continue;
+        }
+        // Leave a quarter of the heap as garbage before every collection
+        std::string garbage = "a = bytearray(" + std::to_string(config.heap_size / 8) + ")\n"
+                              "b = bytearray(" + std::to_string(config.heap_size / 8) + ")";
+        runner.run("gc_pause/" + std::to_string(heapKb) + "KB", 1,
+                   [&] { engine.collectGarbage(); return true; },
+                   [&] { engine.executeString(garbage); });
+    }
+}
+
+void benchExecuteFile(Runner& runner) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "engine_benchmark_script.py";
+    {
+        std::ofstream script(path);
+        for (int i = 0; i < 100; i++) {
+            script << "value_" << i << " = " << i << " * 2\n";
+        }
+    }
+
+    MicroPythonConfig config;
+    MicroPythonEngine cached;
+    if (start(cached, config)) {
+        runner.run("execute_file/cached", 10, [&] { return cached.executeFile(path.string()); });
+    }
+
+    // Every execution maps and compiles the file
+    config.code_cache_size = 0;
+    MicroPythonEngine uncached;
+    if (start(uncached, config)) {
+        runner.run("execute_file/uncached", 10, [&] { return uncached.executeFile(path.string()); });
+    }
+    std::filesystem::remove(path);
+}
+
+void benchEmitter(Runner& runner) {
+    // A numeric inner loop in the style of examples/test_script.py
+    const std::string script =
+        "def squares(n):\n"
+        "    total = 0\n"
+        "    for i in range(n):\n"
+        "        total += i * i\n"
+        "    return total\n"
+        "result = squares(1000)\n";
+    const std::pair<const char*, CodeEmitter> emitters[] = {
+        {"emitter/bytecode loop", CodeEmitter::Bytecode},
+        {"emitter/native loop", CodeEmitter::Native},
+        {"emitter/viper loop", CodeEmitter::Viper},
+    };
+    for (const auto& emitter : emitters) {
+        if (!MicroPythonEngine::hasEmitter(emitter.second)) {
+            runner.skip(emitter.first, "built without MICROPYTHON_NATIVE_EMITTER");
+            continue;
+        }
+        MicroPythonConfig config;
+        config.emitter = emitter.second;
+        MicroPythonEngine engine;
+        if (start(engine, config)) {
+            runner.run(emitter.first, 10, [&] { return engine.executeString(script); });
+        }
+    }
+}
+
+void usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--json] [--iterations N] [--filter NAME]" << std::endl;
+}
+
+/**
+ * Microbenchmarks of the engine's hot paths
+ *
+ * Reports p50/p99/mean latency per operation and throughput; --json prints
+ * the same as JSON for tracking regressions between versions.
+ */
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            options.json = true;
+        } else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            options.iterations = std::max<size_t>(std::strtoul(argv[++i], nullptr, 10), 1);
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    Runner runner(options);
+    benchLifecycle(runner);
+    benchExecute(runner);
+    benchProfiler(runner);
+    benchCall(runner);
+    benchFloat(runner);
+    benchGc(runner);
+    benchExecuteFile(runner);
+    benchEmitter(runner);
+    runner.print();
+    return 0;
+}
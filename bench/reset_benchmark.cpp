@@ -0,0 +1,131 @@
+#include "micropython_engine.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Silences engine output (std::cout and C stdio) while measuring
+ */
+class QuietScope {
+public:
+    QuietScope() : previous(std::cout.rdbuf(sink.rdbuf())) {
+#ifdef __unix__
+        std::fflush(stdout);
+        savedStdout = dup(STDOUT_FILENO);
+        int devNull = open("/dev/null", O_WRONLY);
+        if (devNull >= 0) {
+            dup2(devNull, STDOUT_FILENO);
+            close(devNull);
+        }
+#endif
+    }
+    ~QuietScope() {
+#ifdef __unix__
+        std::fflush(stdout);
+        if (savedStdout >= 0) {
+            dup2(savedStdout, STDOUT_FILENO);
+            close(savedStdout);
+        }
+#endif
+        std::cout.rdbuf(previous);
+    }
+
+private:
+    std::ostringstream sink;
+    std::streambuf* previous;
+#ifdef __unix__
+    int savedStdout = -1;
+#endif
+};
+
+using Clock = std::chrono::steady_clock;
+
+struct Timing {
+    double mean_us = 0;
+    double p50_us = 0;
+    double p99_us = 0;
+};
+
+Timing summarize(std::vector<double>& samples) {
+    Timing timing;
+    std::sort(samples.begin(), samples.end());
+    double total = 0;
+    for (double sample : samples) {
+        total += sample;
+    }
+    timing.mean_us = total / samples.size();
+    timing.p50_us = samples[samples.size() / 2];
+    timing.p99_us = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    return timing;
+}
+
+void report(const char* name, const Timing& timing) {
+    std::cout << name << ": mean " << timing.mean_us << " us, p50 " << timing.p50_us
+              << " us, p99 " << timing.p99_us << " us" << std::endl;
+}
+
+/**
+ * Compares recycling an engine with reset() against shutdown() + initialize()
+ *
+ * Usage: reset_benchmark [iterations] [heap_kb]
+ */
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+    size_t heapKb = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1024;
+    if (iterations == 0) {
+        iterations = 1;
+    }
+
+    MicroPythonConfig config;
+    config.heap_size = heapKb * 1024;
+    const std::string job = "x = 1";
+
+    std::vector<double> reinit;
+    std::vector<double> reset;
+    reinit.reserve(iterations);
+    reset.reserve(iterations);
+
+    {
+        QuietScope quiet;
+        MicroPythonEngine engine;
+        if (!engine.initialize(config)) {
+            std::cerr << "Failed to initialize engine: " << engine.getLastError() << std::endl;
+            return 1;
+        }
+
+        for (size_t i = 0; i < iterations; i++) {
+            engine.executeString(job);
+            Clock::time_point start = Clock::now();
+            engine.shutdown();
+            engine.initialize(config);
+            reinit.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        }
+
+        for (size_t i = 0; i < iterations; i++) {
+            engine.executeString(job);
+            Clock::time_point start = Clock::now();
+            engine.reset();
+            reset.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        }
+    }
+
+    std::cout << "Engine recycling, " << iterations << " iterations, "
+              << heapKb << " KB heap" << std::endl;
+    Timing reinitTiming = summarize(reinit);
+    Timing resetTiming = summarize(reset);
+    report("shutdown + initialize", reinitTiming);
+    report("reset                ", resetTiming);
+    if (resetTiming.mean_us > 0) {
+        std::cout << "reset speedup: " << reinitTiming.mean_us / resetTiming.mean_us << "x" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+# Ahead-of-time compilation of Python sources to .mpy bytecode
+#
+# micropython_add_mpy_target(<target>
+#     SOURCE_DIR <dir>
+#     [OUTPUT_DIR <dir>]
+#     [FLAGS <mpy-cross flags>...])
+#
+# Compiles every .py file under SOURCE_DIR with mpy-cross into OUTPUT_DIR,
+# preserving the relative directory layout. The resulting files can be run
+# with MicroPythonEngine::executeCompiledFile() without invoking the
+# compiler at runtime. If mpy-cross is not available the target is skipped.
+
+find_program(MPY_CROSS_EXECUTABLE
+    NAMES mpy-cross
+    HINTS
+        ${CMAKE_SOURCE_DIR}/external/micropython/mpy-cross/build
+        ${CMAKE_SOURCE_DIR}/external/micropython/mpy-cross
+)
+
+function(micropython_add_mpy_target target)
+    cmake_parse_arguments(MPY "" "SOURCE_DIR;OUTPUT_DIR" "FLAGS" ${ARGN})
+
+    if(NOT MPY_SOURCE_DIR)
+        message(FATAL_ERROR "micropython_add_mpy_target: SOURCE_DIR is required")
+    endif()
+    if(NOT MPY_OUTPUT_DIR)
+        set(MPY_OUTPUT_DIR ${CMAKE_CURRENT_BINARY_DIR}/${target})
+    endif()
+
+    if(NOT MPY_CROSS_EXECUTABLE)
+        message(STATUS "mpy-cross not found, skipping .mpy target ${target} "
+                       "(build it with: make -C external/micropython/mpy-cross)")
+        return()
+    endif()
+
+    get_filename_component(source_root ${MPY_SOURCE_DIR} ABSOLUTE)
+    file(GLOB_RECURSE py_sources CONFIGURE_DEPENDS ${source_root}/*.py)
+
+    set(mpy_outputs "")
+    foreach(py_source ${py_sources})
+        file(RELATIVE_PATH rel_path ${source_root} ${py_source})
+        string(REGEX REPLACE "\\.py$" ".mpy" rel_mpy ${rel_path})
+        set(mpy_output ${MPY_OUTPUT_DIR}/${rel_mpy})
+        get_filename_component(mpy_output_dir ${mpy_output} DIRECTORY)
+
+        add_custom_command(
+            OUTPUT ${mpy_output}
+            COMMAND ${CMAKE_COMMAND} -E make_directory ${mpy_output_dir}
+            COMMAND ${MPY_CROSS_EXECUTABLE} ${MPY_FLAGS} -s ${rel_path} -o ${mpy_output} ${py_source}
+            DEPENDS ${py_source}
+            COMMENT "Compiling ${rel_path} to .mpy"
+            VERBATIM
+        )
+        list(APPEND mpy_outputs ${mpy_output})
+    endforeach()
+
+    add_custom_target(${target} ALL DEPENDS ${mpy_outputs})
+    message(STATUS "Added .mpy target ${target}: ${MPY_SOURCE_DIR} -> ${MPY_OUTPUT_DIR}")
+endfunction()
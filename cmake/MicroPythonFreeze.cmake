@@ -0,0 +1,119 @@
+# Freeze Python modules into a library
+#
+# micropython_freeze_modules(<target>
+#     MODULES <file.py>...
+#     [BASE_DIR <dir>])
+#
+# Module names are the file paths relative to BASE_DIR (default: each
+# file's own directory), so BASE_DIR/pkg/util.py is imported as pkg.util.
+#
+# With the real MicroPython backend and mpy-cross/mpy-tool.py available,
+# the modules are compiled and frozen as bytecode: code objects and their
+# qstrs live in read-only data and importing them needs neither file I/O
+# nor heap allocation for code. Otherwise the sources are frozen as
+# strings, which still avoids file I/O but compiles on first import.
+
+include(MicroPythonCompile)
+
+find_package(Python3 COMPONENTS Interpreter QUIET)
+find_file(MPY_TOOL_SCRIPT mpy-tool.py
+    HINTS ${CMAKE_SOURCE_DIR}/external/micropython/tools
+    NO_DEFAULT_PATH
+)
+
+set(_MICROPYTHON_FREEZE_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/freeze_sources.cmake)
+
+function(micropython_freeze_modules target)
+    cmake_parse_arguments(FREEZE "" "BASE_DIR" "MODULES" ${ARGN})
+
+    if(NOT FREEZE_MODULES)
+        return()
+    endif()
+
+    set(frozen_dir ${CMAKE_CURRENT_BINARY_DIR}/${target}_frozen)
+    set(frozen_c ${frozen_dir}/frozen_content.c)
+
+    # Resolve absolute paths and frozen names ("pkg/util.py")
+    set(module_files "")
+    set(module_names "")
+    foreach(module ${FREEZE_MODULES})
+        get_filename_component(module_abs ${module} ABSOLUTE)
+        if(FREEZE_BASE_DIR)
+            get_filename_component(base_abs ${FREEZE_BASE_DIR} ABSOLUTE)
+            file(RELATIVE_PATH module_name ${base_abs} ${module_abs})
+        else()
+            get_filename_component(module_name ${module_abs} NAME)
+        endif()
+        list(APPEND module_files ${module_abs})
+        list(APPEND module_names ${module_name})
+    endforeach()
+
+    get_target_property(real_backend ${target} MICROPYTHON_REAL_BACKEND)
+    set(qstr_header ${MICROPYTHON_EMBED_DIR}/genhdr/qstrdefs.preprocessed.h)
+
+    if(real_backend AND MPY_CROSS_EXECUTABLE AND MPY_TOOL_SCRIPT AND Python3_FOUND
+       AND EXISTS ${qstr_header})
+        # Frozen bytecode: mpy-cross each module, then let mpy-tool emit
+        # static raw code objects and a frozen qstr pool
+        set(mpy_files "")
+        list(LENGTH module_files module_count)
+        math(EXPR last_index "${module_count} - 1")
+        foreach(index RANGE ${last_index})
+            list(GET module_files ${index} module_abs)
+            list(GET module_names ${index} module_name)
+            string(REGEX REPLACE "\\.py$" ".mpy" mpy_name ${module_name})
+            set(mpy_file ${frozen_dir}/mpy/${mpy_name})
+            get_filename_component(mpy_dir ${mpy_file} DIRECTORY)
+            add_custom_command(
+                OUTPUT ${mpy_file}
+                COMMAND ${CMAKE_COMMAND} -E make_directory ${mpy_dir}
+                COMMAND ${MPY_CROSS_EXECUTABLE} -s ${module_name} -o ${mpy_file} ${module_abs}
+                DEPENDS ${module_abs}
+                COMMENT "Compiling frozen module ${module_name}"
+                VERBATIM
+            )
+            list(APPEND mpy_files ${mpy_file})
+        endforeach()
+
+        add_custom_command(
+            OUTPUT ${frozen_c}
+            COMMAND ${Python3_EXECUTABLE} ${MPY_TOOL_SCRIPT} -f -q ${qstr_header}
+                    -mlongint-impl=none ${mpy_files} > ${frozen_c}
+            DEPENDS ${mpy_files} ${qstr_header}
+            WORKING_DIRECTORY ${frozen_dir}/mpy
+            COMMENT "Freezing ${target} modules as bytecode"
+        )
+
+        target_compile_definitions(${target} PRIVATE
+            MICROPY_MODULE_FROZEN_MPY=1
+            MICROPY_QSTR_EXTRA_POOL=mp_qstr_frozen_const_pool
+        )
+        set(freeze_kind "bytecode")
+    else()
+        # Lists are passed to the script '|'-separated to survive COMMAND
+        # argument expansion
+        string(REPLACE ";" "|" module_files_arg "${module_files}")
+        string(REPLACE ";" "|" module_names_arg "${module_names}")
+        add_custom_command(
+            OUTPUT ${frozen_c}
+            COMMAND ${CMAKE_COMMAND}
+                    -DMODULE_FILES=${module_files_arg}
+                    -DMODULE_NAMES=${module_names_arg}
+                    -DOUTPUT=${frozen_c}
+                    -P ${_MICROPYTHON_FREEZE_SCRIPT}
+            DEPENDS ${module_files} ${_MICROPYTHON_FREEZE_SCRIPT}
+            COMMENT "Freezing ${target} modules as source"
+            VERBATIM
+        )
+
+        target_compile_definitions(${target} PRIVATE MICROPY_MODULE_FROZEN_STR=1)
+        set(freeze_kind "source")
+    endif()
+
+    target_sources(${target} PRIVATE ${frozen_c})
+    set_source_files_properties(${frozen_c} PROPERTIES LANGUAGE C GENERATED TRUE)
+    target_compile_definitions(${target} PRIVATE MICROPYTHON_FROZEN_MODULES=1)
+
+    list(LENGTH module_files module_count)
+    message(STATUS "Freezing ${module_count} module(s) into ${target} as ${freeze_kind}")
+endfunction()
@@ -0,0 +1,43 @@
+# Script mode helper for micropython_freeze_modules(): writes the frozen
+# source table in MicroPython's frozen_content.c layout.
+#
+# Inputs: MODULE_FILES, MODULE_NAMES ('|'-separated parallel lists), OUTPUT
+
+string(REPLACE "|" ";" MODULE_FILES "${MODULE_FILES}")
+string(REPLACE "|" ";" MODULE_NAMES "${MODULE_NAMES}")
+
+set(names "")
+set(sizes "")
+set(content "")
+
+list(LENGTH MODULE_FILES module_count)
+math(EXPR last_index "${module_count} - 1")
+foreach(index RANGE ${last_index})
+    list(GET MODULE_FILES ${index} module_file)
+    list(GET MODULE_NAMES ${index} module_name)
+    file(READ ${module_file} hex HEX)
+    string(LENGTH "${hex}" hex_length)
+    math(EXPR size "${hex_length} / 2")
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+    string(APPEND names "    \"${module_name}\\0\"\n")
+    string(APPEND sizes "    ${size},\n")
+    string(APPEND content "    // ${module_name}\n    ${bytes}0x00,\n")
+endforeach()
+
+file(WRITE ${OUTPUT}
+"// Generated by cmake/freeze_sources.cmake, do not edit.
+
+#include <stdint.h>
+
+const char mp_frozen_names[] = {
+${names}    \"\\0\"
+};
+
+const uint32_t mp_frozen_str_sizes[] = {
+${sizes}    0
+};
+
+const char mp_frozen_str_content[] = {
+${content}    0x00
+};
+")
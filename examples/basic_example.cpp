@@ -17,6 +17,7 @@ int main() {
         config.heap_size = 128 * 1024;  // 128KB heap
         config.enable_gc = true;
         config.enable_repl = false;
+        config.output = std::make_shared<StdoutSink>();  // Show script output
         
         // Initialize engine
         std::cout << "\n1. Initializing MicroPython engine..." << std::endl;
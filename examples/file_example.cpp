@@ -12,6 +12,7 @@ int main() {
         MicroPythonEngine engine;
         MicroPythonConfig config;
         config.heap_size = 64 * 1024;  // 64KB heap
+        config.output = std::make_shared<StdoutSink>();  // Show script output
         
         if (!engine.initialize(config)) {
             std::cerr << "Failed to initialize engine: " << engine.getLastError() << std::endl;
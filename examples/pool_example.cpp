@@ -0,0 +1,55 @@
+#include "engine_pool.h"
+#include <iostream>
+#include <vector>
+
+/**
+ * Engine Pool Example
+ */
+int main() {
+    std::cout << "=== MicroPython Engine Pool Example ===" << std::endl;
+    
+    try {
+        // One engine per worker, bounded queue that blocks when full
+        EnginePoolConfig config;
+        config.workers = 4;
+        config.queue_capacity = 64;
+        config.overflow = OverflowPolicy::Block;
+        config.engine.heap_size = 64 * 1024;
+        
+        EnginePool pool(config);
+        std::cout << "Pool started with " << pool.size() << " workers" << std::endl;
+        
+        // Submit a batch of scripts
+        std::vector<std::future<ExecutionResult>> results;
+        for (int i = 0; i < 16; i++) {
+            results.push_back(pool.submit("result = " + std::to_string(i) + " * 2"));
+        }
+        
+        size_t succeeded = 0;
+        for (auto& result : results) {
+            ExecutionResult outcome = result.get();
+            if (outcome.success) {
+                succeeded++;
+            } else {
+                std::cerr << "Job failed: " << outcome.error << std::endl;
+            }
+        }
+        std::cout << succeeded << "/" << results.size() << " jobs succeeded" << std::endl;
+        
+        // Per-worker statistics
+        std::vector<WorkerStats> stats = pool.getWorkerStats();
+        for (size_t i = 0; i < stats.size(); i++) {
+            std::cout << "Worker " << i << " (cpu " << stats[i].cpu << "): "
+                      << stats[i].jobs_completed << " jobs, "
+                      << stats[i].jobs_stolen << " stolen, p50 "
+                      << stats[i].p50_latency.count() << " ns, p99 "
+                      << stats[i].p99_latency.count() << " ns" << std::endl;
+        }
+        
+    } catch (const MicroPythonException& e) {
+        std::cerr << "MicroPython exception: " << e.what() << std::endl;
+        return -1;
+    }
+    
+    return 0;
+}
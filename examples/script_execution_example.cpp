@@ -213,6 +213,7 @@ int main() {
         config.heap_size = 256 * 1024;  // 256KB heap
         config.enable_gc = true;
         config.enable_repl = true;  // Enable REPL mode for better display
+        config.output = std::make_shared<StdoutSink>();  // Show script output
         
         std::cout << "\n1. Initializing MicroPython engine..." << std::endl;
         if (!engine.initialize(config)) {
@@ -0,0 +1,125 @@
+#ifndef ENGINE_POOL_H
+#define ENGINE_POOL_H
+
+#include "micropython_engine.h"
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * What submit() does when the pool queue is full
+ */
+enum class OverflowPolicy {
+    Block,   // Wait until a slot frees up
+    Reject   // Fail the job immediately with a "queue full" error
+};
+
+/**
+ * Engine Pool Configuration
+ */
+struct EnginePoolConfig {
+    size_t workers = 0;                         // Worker threads (0 = one per CPU core)
+    bool pin_workers = true;                    // Pin worker N to the Nth CPU the process may use
+    size_t queue_capacity = 1024;               // Max queued jobs across all workers
+    OverflowPolicy overflow = OverflowPolicy::Block;
+    MicroPythonConfig engine;                   // Configuration of every worker engine
+};
+
+/**
+ * Per-worker Statistics
+ */
+struct WorkerStats {
+    size_t jobs_completed = 0;                  // Jobs that ran (successful or not)
+    size_t jobs_failed = 0;                     // Jobs that reported an error
+    size_t jobs_stolen = 0;                     // Jobs taken from another worker's queue
+    int cpu = -1;                               // Core the worker is pinned to (-1 if not)
+    std::chrono::nanoseconds mean_latency{0};   // Mean execution time
+    std::chrono::nanoseconds p50_latency{0};    // Median execution time (bucketed)
+    std::chrono::nanoseconds p99_latency{0};    // 99th percentile execution time (bucketed)
+    std::chrono::nanoseconds max_latency{0};    // Slowest job
+    std::chrono::nanoseconds mean_queue_wait{0};// Mean time between submit and start
+};
+
+/**
+ * Pool of pre-initialized MicroPython engines
+ *
+ * Each worker thread owns one engine and a job deque. Jobs submitted from
+ * outside the pool are spread round-robin over the workers; an idle worker
+ * steals from the back of a busy worker's deque. The total number of queued
+ * jobs is bounded by EnginePoolConfig::queue_capacity.
+ *
+ * Tasks may submit follow-up jobs; those queue on the submitting worker.
+ * A worker never blocks for queue space, even with OverflowPolicy::Block:
+ * a submit() from a task fails with ErrorCode::ResourceError when the
+ * queue is full. A task must not wait for a job it submitted (its worker
+ * may be the only one to run it), and shutdown() called from a task only
+ * stops accepting jobs; the workers are joined by the owner's shutdown()
+ * or the destructor, which must not run on a worker.
+ */
+class EnginePool {
+public:
+    using Task = std::function<ExecutionResult(MicroPythonEngine&)>;
+
+    /**
+     * Start the workers and initialize one engine per worker
+     * @param config Pool configuration
+     * @throws MicroPythonException if an engine fails to initialize
+     */
+    explicit EnginePool(const EnginePoolConfig& config = EnginePoolConfig());
+
+    /**
+     * Destructor, finishes queued jobs and joins the workers
+     */
+    ~EnginePool();
+
+    /**
+     * Queue Python code for execution on any worker
+     * @param code Python code to execute
+     * @return Future holding the job outcome
+     */
+    std::future<ExecutionResult> submit(std::string code);
+
+    /**
+     * Queue an arbitrary job that runs against a worker's engine
+     * @param task Callable receiving the worker's engine
+     * @return Future holding the value returned by the task
+     */
+    std::future<ExecutionResult> submitTask(Task task);
+
+    /**
+     * Stop accepting jobs, run everything already queued and join workers
+     * From a task it only stops accepting jobs (see the class comment).
+     */
+    void shutdown();
+
+    /**
+     * Get number of workers
+     * @return Worker thread count
+     */
+    size_t size() const;
+
+    /**
+     * Get number of jobs waiting to run
+     * @return Queued job count
+     */
+    size_t pending() const;
+
+    /**
+     * Get per-worker statistics
+     * @return One entry per worker
+     */
+    std::vector<WorkerStats> getWorkerStats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+
+    // Non-copyable
+    EnginePool(const EnginePool&) = delete;
+    EnginePool& operator=(const EnginePool&) = delete;
+};
+
+#endif // ENGINE_POOL_H
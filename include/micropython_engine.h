@@ -4,14 +4,80 @@
 #include <string>
 #include <memory>
 #include <stdexcept>
+#include <vector>
+#include <functional>
+#include <future>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <string_view>
+#include "micropython_module.h"
+#include "micropython_output.h"
+#include "micropython_value.h"
+
+/**
+ * Category of the last error (see MicroPythonEngine::getLastErrorCode())
+ */
+enum class ErrorCode {
+    None,               // No error
+    InvalidState,       // Engine not initialized, already initialized, ...
+    InvalidArgument,    // Empty code, empty name, ...
+    IoError,            // File or snapshot could not be read or written
+    CompileError,       // Compilation or .mpy loading failed
+    PythonException,    // Uncaught Python exception
+    ConversionError,    // A call result could not be converted to the C++ type
+    Interrupted,        // Stopped by interrupt() or job cancellation
+    Timeout,            // Stopped after max_execution_time
+    ResourceError,      // Heap, context or object allocation failed (MemoryError)
+    QuotaExceeded,      // The job went over job_alloc_quota or job_live_quota (MemoryError)
+    Unsupported,        // Not available in this build
+    Internal            // Unexpected C++ exception inside the engine
+};
 
 /**
  * MicroPython Engine Exception Class
  */
 class MicroPythonException : public std::runtime_error {
 public:
-    explicit MicroPythonException(const std::string& message) 
-        : std::runtime_error(message) {}
+    explicit MicroPythonException(const std::string& message, ErrorCode code = ErrorCode::Internal)
+        : std::runtime_error(message), code_(code) {}
+    
+    ErrorCode code() const {
+        return code_;
+    }
+    
+private:
+    ErrorCode code_;
+};
+
+/**
+ * When the engine runs garbage collection
+ */
+enum class GcMode {
+    Automatic,  // Inside allocations, once gc_threshold bytes were allocated or the heap is full
+    Idle,       // Between jobs via collectIfIdle(); inside allocations only when the heap is full
+    Manual      // Only via collectGarbage(); a full heap raises MemoryError
+};
+
+/**
+ * Code generator for scripts compiled by an engine
+ */
+enum class CodeEmitter {
+    Bytecode,   // Interpreted bytecode (always available)
+    Native,     // Machine code, as if every function had @micropython.native
+    Viper       // Machine code with viper typing (@micropython.viper)
+};
+
+/**
+ * How the Python heap is allocated
+ */
+enum class HeapStrategy {
+    New,                    // operator new[], page-aligned
+    Mmap,                   // Anonymous mmap, 4KB pages
+    TransparentHugePages,   // Anonymous mmap, 2MB aligned, madvise(MADV_HUGEPAGE)
+    HugePages,              // mmap(MAP_HUGETLB); falls back to TransparentHugePages
+    UserBuffer              // heap_buffer supplied by the caller (heap_size bytes)
 };
 
 /**
@@ -19,14 +85,209 @@ public:
  */
 struct MicroPythonConfig {
     size_t heap_size = 64 * 1024;  // Default 64KB heap
-    bool enable_gc = true;          // Enable garbage collection
+    bool enable_gc = true;          // Enable automatic garbage collection (false = GcMode::Manual)
     bool enable_repl = false;       // Enable REPL mode
     std::string script_path = "";   // Path to Python scripts
+    size_t code_cache_size = 64;    // Max cached compiled scripts (0 disables)
+    size_t stack_limit = 32 * 1024; // C stack bytes the VM may use per call
+    GcMode gc_mode = GcMode::Automatic;
+    size_t gc_threshold = 0;        // Bytes allocated between collections (0 = heap full / any, see GcMode)
+    HeapStrategy heap_strategy = HeapStrategy::New;
+    bool heap_prefault = false;     // Fault every heap page in during initialize()
+    int heap_numa_node = -1;        // Bind the heap to a NUMA node (-1 = first touch)
+    void* heap_buffer = nullptr;    // Heap memory for HeapStrategy::UserBuffer
+    std::shared_ptr<OutputSink> output; // Script output (nullptr = the engine's ring, see outputBuffer())
+    LogLevel log_level = LogLevel::Off; // Engine diagnostics at or above this level are logged
+    LogHandler log_handler;         // Receives diagnostics (nullptr = stderr)
+    std::chrono::milliseconds max_execution_time{0}; // Interrupt code running longer (0 = no limit)
+    size_t job_alloc_quota = 0;     // Bytes one job may allocate (0 = no limit)
+    size_t job_live_quota = 0;      // Bytes one job may add to the live heap (0 = no limit)
+    CodeEmitter emitter = CodeEmitter::Bytecode;    // Native/Viper need MICROPYTHON_NATIVE_EMITTER
+};
+
+/**
+ * Outcome of a script job run asynchronously or on a pool worker
+ */
+struct ExecutionResult {
+    bool success = false;   // true if the job completed without error
+    std::string error;      // Error message when success is false
+    ErrorCode code = ErrorCode::None;   // Error category when success is false
+};
+
+/**
+ * Completion callback for executeAsync(), invoked on the executor thread
+ */
+using AsyncCallback = std::function<void(const ExecutionResult&)>;
+
+struct AsyncJobState;
+class MicroPythonEngine;
+
+/**
+ * Handle to a job started with MicroPythonEngine::executeAsync()
+ */
+class AsyncJob {
+public:
+    std::future<ExecutionResult> result;    // Outcome of the job
+    
+    /**
+     * Cancel the job: a queued job never runs, an in-flight job is
+     * interrupted. Either way the result reports "Cancelled".
+     * @return true if the job had not finished yet, false otherwise
+     */
+    bool cancel();
+    
+private:
+    friend class MicroPythonEngine;
+    std::shared_ptr<AsyncJobState> state;
+};
+
+struct BufferState;
+
+/**
+ * Whether Python may write to an exposed buffer
+ */
+enum class BufferAccess {
+    ReadOnly,
+    ReadWrite
+};
+
+/**
+ * memoryview typecode of a buffer element type (0 = not supported)
+ */
+template <typename T> struct BufferTypecode { static constexpr char value = 0; };
+template <> struct BufferTypecode<char> { static constexpr char value = 'B'; };
+template <> struct BufferTypecode<int8_t> { static constexpr char value = 'b'; };
+template <> struct BufferTypecode<uint8_t> { static constexpr char value = 'B'; };
+template <> struct BufferTypecode<int16_t> { static constexpr char value = 'h'; };
+template <> struct BufferTypecode<uint16_t> { static constexpr char value = 'H'; };
+template <> struct BufferTypecode<int32_t> { static constexpr char value = 'i'; };
+template <> struct BufferTypecode<uint32_t> { static constexpr char value = 'I'; };
+template <> struct BufferTypecode<int64_t> { static constexpr char value = 'q'; };
+template <> struct BufferTypecode<uint64_t> { static constexpr char value = 'Q'; };
+template <> struct BufferTypecode<float> { static constexpr char value = 'f'; };
+template <> struct BufferTypecode<double> { static constexpr char value = 'd'; };
+
+/**
+ * Lifetime guard of host memory exposed with MicroPythonEngine::exposeBuffer()
+ *
+ * While the handle is alive, Python sees the memory as a memoryview bound
+ * to a global name. Releasing the handle (or destroying it) waits for any
+ * running script to finish and then detaches the view: later accesses see
+ * an empty memoryview, never the host memory. Engine shutdown() and reset()
+ * detach every buffer as well.
+ */
+class BufferHandle {
+public:
+    BufferHandle() = default;
+    ~BufferHandle() {
+        release();
+    }
+    BufferHandle(BufferHandle&& other) noexcept = default;
+    BufferHandle& operator=(BufferHandle&& other) noexcept {
+        if (this != &other) {
+            release();
+            state = std::move(other.state);
+        }
+        return *this;
+    }
+    
+    /**
+     * Detach the buffer from Python
+     */
+    void release();
+    
+    /**
+     * Check whether Python can still reach the buffer
+     * @return true until released or detached by the engine
+     */
+    bool attached() const;
+    
+private:
+    friend class MicroPythonEngine;
+    std::shared_ptr<BufferState> state;
+    
+    BufferHandle(const BufferHandle&) = delete;
+    BufferHandle& operator=(const BufferHandle&) = delete;
+};
+
+/**
+ * Heap Statistics (from the MicroPython GC)
+ */
+struct HeapStats {
+    size_t total = 0;                       // Heap size in bytes
+    size_t used = 0;                        // Bytes in allocated blocks
+    size_t free = 0;                        // Bytes in free blocks
+    size_t largest_free = 0;                // Largest contiguous free run in bytes
+    size_t block_size = 0;                  // GC allocation block size in bytes
+    size_t blocks_1 = 0;                    // Live allocations of one block
+    size_t blocks_2 = 0;                    // Live allocations of two blocks
+    size_t largest_block = 0;               // Largest live allocation in bytes
+    size_t allocated_since_gc = 0;          // Bytes allocated since the last collection
+    uint64_t allocations = 0;               // Heap allocations made so far
+    uint64_t collections = 0;               // Garbage collections run so far
+    std::chrono::microseconds gc_time{0};   // Cumulative GC pause time
+    size_t exec_used = 0;                   // Executable memory held by native code
+};
+
+/**
+ * Memory used by the last job (see MicroPythonEngine::getLastJobUsage())
+ */
+struct JobUsage {
+    size_t allocated = 0;   // Bytes allocated, including garbage collected during the job
+    size_t peak_live = 0;   // Peak growth of the live heap over its size when the job started
+};
+
+/**
+ * Compiled Code Cache Statistics
+ */
+struct CodeCacheStats {
+    size_t hits = 0;        // Executions that reused compiled code
+    size_t misses = 0;      // Executions that had to compile
+    size_t evictions = 0;   // Entries dropped by LRU eviction
+    size_t entries = 0;     // Entries currently cached
+    size_t capacity = 0;    // Maximum number of entries
+};
+
+/**
+ * Hot reload statistics (see MicroPythonEngine::watchModules())
+ */
+struct ReloadStats {
+    uint64_t reloads = 0;       // Changed modules swapped into sys.modules
+    uint64_t failures = 0;      // Modules that failed to load (the previous version stays)
+    std::chrono::microseconds last_latency{0};  // Change noticed to module swapped, last reload
+    std::chrono::microseconds max_latency{0};
+    std::chrono::microseconds total_latency{0}; // Sum over all reloads (mean = total / reloads)
+};
+
+/**
+ * Sampling profiler statistics (see MicroPythonEngine::startProfiling())
+ */
+struct ProfileStats {
+    uint64_t samples = 0;       // Call stacks recorded
+    uint64_t dropped = 0;       // Samples lost because the sample ring was full
+    std::chrono::microseconds interval{0};  // Time between samples of the last session
+};
+
+/**
+ * Failure of one item of MicroPythonEngine::callBatch()
+ */
+struct BatchItemError {
+    size_t index = 0;       // Index of the failed input
+    std::string message;    // "ExceptionType: message" or conversion error
 };
 
 /**
  * MicroPython Engine Wrapper Class
  * Provides C++ interface for embedding MicroPython
+ *
+ * Every engine owns a complete, independent VM (interpreter state, heap,
+ * qstr pool and stack limits), so several engines can run in parallel on
+ * different threads. The entry points of one engine are serialized by its
+ * VM lock, so an engine may be shared between threads but runs one call at
+ * a time; a call from a second thread waits for the first to return.
+ * interrupt() is the only call that does not take the lock and may be used
+ * to stop a running call from another thread (the profiling accessors do
+ * not touch the VM either).
  */
 class MicroPythonEngine {
 public:
@@ -52,6 +313,35 @@ public:
      */
     void shutdown();
     
+    /**
+     * Initialize the engine from a snapshot image written by saveSnapshot()
+     * The heap is mapped copy-on-write from the file at the address it was
+     * saved from, so processes restoring the same image share its clean
+     * pages. Only one engine per process can map a given image at a time.
+     * @param path Snapshot image file
+     * @param config Engine configuration (heap_size and heap strategy are
+     *               taken from the image)
+     * @return true if successful, false otherwise
+     */
+    bool initializeFromSnapshot(const std::string& path, const MicroPythonConfig& config = MicroPythonConfig());
+    
+    /**
+     * Save the VM state (heap, globals, loaded modules) to an image file,
+     * typically after warm-up imports. Runs a collection first. The heap
+     * must be page-aligned (every strategy but an unaligned UserBuffer).
+     * @param path Destination file
+     * @return true if successful, false otherwise
+     */
+    bool saveSnapshot(const std::string& path);
+    
+    /**
+     * Soft reset: drop globals, sys.modules and every heap object while
+     * keeping the heap allocation and runtime structures. Much cheaper
+     * than shutdown() followed by initialize().
+     * @return true if successful, false otherwise
+     */
+    bool reset();
+    
     /**
      * Check if engine is initialized
      * @return true if initialized, false otherwise
@@ -65,37 +355,388 @@ public:
      */
     bool executeString(const std::string& code);
     
+    /**
+     * Execute Python code, capturing its output instead of sending it to
+     * the output sink
+     * @param code Python code to execute
+     * @param output Receives everything the code printed
+     * @return true if successful, false otherwise
+     */
+    bool executeString(const std::string& code, std::string& output);
+    
+    /**
+     * Get the engine's default output sink
+     * Script output lands here unless MicroPythonConfig::output is set;
+     * drain it in bulk with RingBufferSink::drain() or read().
+     * @return Ring buffer holding undrained output
+     */
+    RingBufferSink& outputBuffer();
+    
     /**
      * Execute Python file
+     * The file is compiled straight from a read-only mapping, so it must
+     * not be truncated or rewritten in place meanwhile (replace it with
+     * rename(); modules under watchModules() are read instead).
      * @param filename Path to Python file
      * @return true if successful, false otherwise
      */
     bool executeFile(const std::string& filename);
     
+    /**
+     * Execute precompiled .mpy bytecode from memory
+     * Skips the lexer, parser and compiler entirely
+     * @param data Pointer to the .mpy image
+     * @param len Size of the image in bytes
+     * @return true if successful, false otherwise
+     */
+    bool executeCompiled(const void* data, size_t len);
+    
+    /**
+     * Execute precompiled .mpy file (see micropython_add_mpy_target in CMake)
+     * Mapped like executeFile(); the same no-truncate rule applies.
+     * @param filename Path to .mpy file
+     * @return true if successful, false otherwise
+     */
+    bool executeCompiledFile(const std::string& filename);
+    
+    /**
+     * Execute Python code asynchronously on the engine's executor thread
+     * Jobs run one at a time in submission order; the executor thread is
+     * started on first use and stopped by shutdown()
+     * @param code Python code to execute
+     * @param callback Optional callback invoked with the result on completion
+     * @return Handle with a future for the result and cancel()
+     */
+    AsyncJob executeAsync(const std::string& code, AsyncCallback callback = nullptr);
+    
     /**
      * Get last error message
      * @return Error message string
      */
     std::string getLastError() const;
     
+    /**
+     * Get the category of the last error
+     * @return ErrorCode::None if the last operation succeeded
+     */
+    ErrorCode getLastErrorCode() const;
+    
+    /**
+     * Interrupt the code running in this engine with KeyboardInterrupt
+     * Safe to call from any thread. The interrupted operation fails with
+     * ErrorCode::Interrupted. If nothing is running, the next execution is
+     * interrupted as soon as it starts.
+     */
+    void interrupt();
+    
     /**
      * Force garbage collection
      */
     void collectGarbage();
     
+    /**
+     * Run garbage collection only if it is expected to fit in a time budget
+     * The estimate is based on this engine's previous pauses
+     * @param budget Maximum acceptable pause
+     * @return true if a collection ran, false if it was skipped
+     */
+    bool collectGarbage(std::chrono::microseconds budget);
+    
+    /**
+     * Idle-time collection hook, called between jobs by the async executor
+     * and EnginePool workers. In GcMode::Idle it collects once gc_threshold
+     * bytes (any bytes if 0) were allocated since the last collection.
+     * @param budget Maximum acceptable pause
+     * @return true if a collection ran
+     */
+    bool collectIfIdle(std::chrono::microseconds budget = std::chrono::microseconds::max());
+    
+    /**
+     * Enable or disable collection inside allocations, e.g. while a
+     * latency-critical script runs (see NoGcScope). While disabled a full
+     * heap raises MemoryError.
+     * @param enabled New setting
+     * @return Previous setting
+     */
+    bool setAutoCollect(bool enabled);
+    
+    /**
+     * Set the allocation threshold (like gc.threshold())
+     * @param bytes Bytes allocated between collections (0 = see GcMode)
+     */
+    void setGcThreshold(size_t bytes);
+    
     /**
      * Get memory usage statistics
-     * @return Memory usage in bytes
+     * @return Bytes currently allocated on the Python heap
      */
     size_t getMemoryUsage() const;
     
+    /**
+     * Get detailed heap statistics
+     * @return Usage, fragmentation and GC counters (all zero if not initialized)
+     */
+    HeapStats getHeapStats() const;
+    
+    /**
+     * Limit the memory of each job (execution, call or batch)
+     * An allocation that would go over a limit raises MemoryError in the
+     * script and the job fails with ErrorCode::QuotaExceeded. The heap is
+     * collected afterwards, so the engine runs the next job without reset.
+     * @param allocBytes Bytes a job may allocate (0 = no limit)
+     * @param liveBytes Bytes a job may add to the live heap (0 = no limit)
+     */
+    void setJobQuota(size_t allocBytes, size_t liveBytes);
+    
+    /**
+     * Get the memory used by the last job
+     * Only tracked while a quota is set.
+     * @return Allocation totals of the last job
+     */
+    JobUsage getLastJobUsage() const;
+    
     /**
      * Get heap size
      * @return Heap size in bytes
      */
     size_t getHeapSize() const;
+    
+    /**
+     * List modules frozen into the library at build time
+     * (see MICROPYTHON_FROZEN_MODULES in CMake)
+     * @return Frozen module file names, e.g. "helpers.py"
+     */
+    static std::vector<std::string> getFrozenModules();
+    
+    /**
+     * Check whether a code emitter was built in
+     * @param emitter Emitter to check
+     * @return true for Bytecode, and for Native/Viper when built with
+     *         MICROPYTHON_NATIVE_EMITTER
+     */
+    static bool hasEmitter(CodeEmitter emitter);
+    
+    /**
+     * Get compiled code cache statistics
+     * @return Hit/miss counters and current occupancy
+     */
+    CodeCacheStats getCodeCacheStats() const;
+    
+    /**
+     * Drop all cached compiled code
+     */
+    void clearCodeCache();
+    
+    /**
+     * Load every .py module of a directory into sys.modules and reload
+     * modules whenever their file changes (inotify; Linux only)
+     * A watcher thread reads and compiles a changed file, runs it as a new
+     * module and swaps it into sys.modules between jobs, so running code
+     * never sees a half-loaded module. A module that fails to load keeps
+     * its previous version. Stopped by unwatchModules() and shutdown().
+     * @param directory Directory holding the modules
+     * @return true if the directory is being watched
+     */
+    bool watchModules(const std::string& directory);
+    
+    /**
+     * Stop watching modules; loaded modules stay in sys.modules
+     * Must not be called from Python code running in this engine.
+     */
+    void unwatchModules();
+    
+    /**
+     * Get hot reload statistics
+     * @return Reload counters and latencies
+     */
+    ReloadStats getReloadStats() const;
+    
+    /**
+     * Start sampling the Python code this engine runs
+     * While the engine runs code, a shared profiler thread asks the VM every
+     * interval to record the current call stack (function, file and line
+     * of every frame) at its next poll point. The VM does no extra work
+     * between samples and none at all while profiling is off. Clears the
+     * samples of the previous session.
+     * @param interval Time between samples (at least 100 us)
+     * @return false if the engine is not initialized or cannot be profiled
+     */
+    bool startProfiling(std::chrono::microseconds interval = std::chrono::milliseconds(1));
+    
+    /**
+     * Stop sampling; the samples stay available until the next startProfiling()
+     */
+    void stopProfiling();
+    
+    /**
+     * Check if profiling is on
+     * @return true between startProfiling() and stopProfiling()
+     */
+    bool isProfiling() const;
+    
+    /**
+     * Get the samples in folded stack format
+     * One "frame;frame;... count" line per distinct stack, outermost frame
+     * first, each frame written as "function (file:line)"; feed it to
+     * flamegraph.pl or speedscope.
+     * @return Folded stacks, empty without samples
+     */
+    std::string getProfile() const;
+    
+    /**
+     * Get sampling profiler statistics
+     * @return Sample counters of the current or last session
+     */
+    ProfileStats getProfileStats() const;
+    
+    /**
+     * Expose host memory to Python as a memoryview, without copying
+     * The memory must stay valid until the returned handle is released.
+     * @param name Global name the memoryview is bound to
+     * @param data First element
+     * @param count Number of elements
+     * @param access ReadOnly to forbid writes (always read-only for const T)
+     * @return Handle guarding the buffer; not attached on failure (see getLastError())
+     */
+    template <typename T>
+    BufferHandle exposeBuffer(const std::string& name, T* data, size_t count,
+                              BufferAccess access = BufferAccess::ReadWrite) {
+        using Element = typename std::remove_const<T>::type;
+        static_assert(BufferTypecode<Element>::value != 0, "Unsupported buffer element type");
+        bool writable = !std::is_const<T>::value && access == BufferAccess::ReadWrite;
+        return exposeRawBuffer(name, const_cast<Element*>(data), count * sizeof(Element),
+                               BufferTypecode<Element>::value, writable);
+    }
+    
+    /**
+     * Expose a contiguous container (std::vector, std::array, ...)
+     * @param name Global name the memoryview is bound to
+     * @param container Container; a const container is exposed read-only
+     * @param access ReadOnly to forbid writes
+     * @return Handle guarding the buffer
+     */
+    template <typename Container>
+    BufferHandle exposeBuffer(const std::string& name, Container& container,
+                              BufferAccess access = BufferAccess::ReadWrite) {
+        return exposeBuffer(name, std::data(container), std::size(container), access);
+    }
+
+    /**
+     * Maximum number of arguments of call()
+     */
+    static constexpr size_t MaxCallArgs = 16;
+    
+    /**
+     * Call a Python function with C++ arguments
+     * The function ("func" in __main__/builtins or "module.func") is
+     * resolved once and cached until code is executed or the engine is
+     * reset. Small-int, bool and None arguments and results never allocate.
+     * @param function Function name
+     * @param args Arguments (integers, bool, floating point, strings,
+     *             std::vector/std::array of those, nullptr for None)
+     * @return Result converted to R (see ResultConverter)
+     * @throws MicroPythonException if the call fails or the result cannot
+     *         be converted (getLastError() holds the same message)
+     */
+    template <typename R = void, typename... Args>
+    R call(std::string_view function, const Args&... args) {
+        static_assert(sizeof...(Args) <= MaxCallArgs, "Too many arguments for call()");
+        CallArg converted[sizeof...(Args) + 1];
+        size_t index = 0;
+        (void)index;
+        (ArgConverter<typename std::decay<Args>::type>::convert(args, converted[index++]), ...);
+        
+        if constexpr (std::is_void<R>::value) {
+            if (!invokeFunction(function, converted, sizeof...(Args), nullptr, nullptr)) {
+                throw MicroPythonException(getLastError(), getLastErrorCode());
+            }
+        } else {
+            R result{};
+            ResultDecoder decode = [](const PythonValue& value, void* out) {
+                return ResultConverter<R>::convert(value, *static_cast<R*>(out));
+            };
+            if (!invokeFunction(function, converted, sizeof...(Args), decode, &result)) {
+                throw MicroPythonException(getLastError(), getLastErrorCode());
+            }
+            return result;
+        }
+    }
+    
+    /**
+     * Call a Python function once per input, all in one VM entry
+     * The engine is locked, the function resolved and the argument slots
+     * reserved once for the whole batch. A failing item is reported and
+     * the batch goes on with the next one.
+     * @param function Function name (as for call())
+     * @param inputs Contiguous range of inputs; std::tuple/std::pair
+     *               inputs are unpacked into arguments
+     * @param outputs Resized to the number of inputs and filled with the
+     *                results (failed items stay value-initialized)
+     * @return Errors of the failed items, in input order
+     * @throws MicroPythonException if the batch cannot run (engine not
+     *         initialized, unknown function, interrupted)
+     */
+    template <typename R, typename Inputs>
+    std::vector<BatchItemError> callBatch(std::string_view function, const Inputs& inputs,
+                                          std::vector<R>& outputs) {
+        using Input = typename std::decay<decltype(*std::data(inputs))>::type;
+        static_assert(BatchArgs<Input>::count <= MaxCallArgs, "Too many arguments for callBatch()");
+        outputs.assign(std::size(inputs), R{});
+        
+        BatchArgFn arguments = [](const void* data, size_t index, CallArg* args) {
+            BatchArgs<Input>::convert(static_cast<const Input*>(data)[index], args);
+            return BatchArgs<Input>::count;
+        };
+        BatchResultFn decode = [](const PythonValue& value, void* out, size_t index) {
+            R result{};
+            if (!ResultConverter<R>::convert(value, result)) {
+                return false;
+            }
+            (*static_cast<std::vector<R>*>(out))[index] = std::move(result);
+            return true;
+        };
+        std::vector<BatchItemError> errors;
+        if (!invokeBatch(function, std::data(inputs), std::size(inputs), arguments,
+                         decode, &outputs, errors)) {
+            throw MicroPythonException(getLastError(), getLastErrorCode());
+        }
+        return errors;
+    }
+    
+    /**
+     * Drop cached function lookups (done automatically when code runs)
+     */
+    void clearFunctionCache();
+    
+    /**
+     * Get (or create) a native module importable from Python
+     * The module stays registered across reset(), shutdown() and
+     * initialize(); functions can be added at any time.
+     * @param name Module name used by `import`
+     * @return Module to add functions to with def()
+     */
+    NativeModule& registerModule(const std::string& name);
 
 private:
+    friend class AsyncJob;
+    friend class BufferHandle;
+    friend class NativeModule;
+    
+    using ResultDecoder = bool (*)(const PythonValue& value, void* out);
+    using BatchArgFn = size_t (*)(const void* inputs, size_t index, CallArg* args);
+    using BatchResultFn = bool (*)(const PythonValue& value, void* outputs, size_t index);
+    
+    bool invokeFunction(std::string_view function, const CallArg* args, size_t count,
+                        ResultDecoder decode, void* out);
+    bool invokeBatch(std::string_view function, const void* inputs, size_t count,
+                     BatchArgFn arguments, BatchResultFn decode, void* outputs,
+                     std::vector<BatchItemError>& errors);
+    
+    BufferHandle exposeRawBuffer(const std::string& name, void* data, size_t len,
+                                 char typecode, bool writable);
+    
+    void installModule(const NativeModule& module);
+    
     // Private implementation details
     class Impl;
     std::unique_ptr<Impl> pImpl;
@@ -105,4 +746,23 @@ private:
     MicroPythonEngine& operator=(const MicroPythonEngine&) = delete;
 };
 
+/**
+ * Disables automatic garbage collection for the lifetime of the scope
+ */
+class NoGcScope {
+public:
+    explicit NoGcScope(MicroPythonEngine& engine)
+        : engine_(engine), previous_(engine.setAutoCollect(false)) {}
+    ~NoGcScope() {
+        engine_.setAutoCollect(previous_);
+    }
+    
+private:
+    MicroPythonEngine& engine_;
+    bool previous_;
+    
+    NoGcScope(const NoGcScope&) = delete;
+    NoGcScope& operator=(const NoGcScope&) = delete;
+};
+
 #endif // MICROPYTHON_ENGINE_H
@@ -0,0 +1,157 @@
+#ifndef MICROPYTHON_MODULE_H
+#define MICROPYTHON_MODULE_H
+
+#include "micropython_value.h"
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class MicroPythonEngine;
+
+/**
+ * Module of C++ functions importable from Python
+ *
+ * Obtained from MicroPythonEngine::registerModule(). def() instantiates a
+ * trampoline for the exact signature of each function: a call from Python
+ * unboxes the arguments with ResultConverter<T>, calls the function
+ * directly and boxes the result with ArgConverter<R>. There is no runtime
+ * type dispatch and no std::function in between.
+ *
+ * The function table lives outside the GC heap, so `import host` and
+ * attribute lookups allocate nothing.
+ */
+class NativeModule {
+public:
+    /**
+     * Trampoline as called by the VM
+     */
+    using Trampoline = int (*)(void* data, size_t n_args, const mp_embed_obj_t* args,
+                               mp_embed_obj_t* result);
+
+    struct Function {
+        std::string name;
+        Trampoline trampoline;
+        std::unique_ptr<void, void (*)(void*)> target;  // Passed as trampoline data
+    };
+
+    /**
+     * Add (or replace) a function
+     * @param name Python name of the function
+     * @param function Function pointer, lambda or function object with a
+     *        single non-template call operator; it is copied into the module
+     * @return This module, for chaining
+     */
+    template <typename F>
+    NativeModule& def(const std::string& name, F function) {
+        std::unique_ptr<void, void (*)(void*)> target(
+            new F(std::move(function)), [](void* p) { delete static_cast<F*>(p); });
+        return add(name, Signature<F>::template trampoline<F>(), std::move(target));
+    }
+
+    const std::string& name() const {
+        return name_;
+    }
+
+    const std::vector<Function>& functions() const {
+        return functions_;
+    }
+
+private:
+    friend class MicroPythonEngine;
+
+    static constexpr int Ok = 0;
+
+    NativeModule(MicroPythonEngine& engine, const std::string& name)
+        : engine_(engine), name_(name) {}
+
+    NativeModule& add(const std::string& name, Trampoline trampoline,
+                      std::unique_ptr<void, void (*)(void*)> target);
+
+    // Out-of-line helpers (they need the VM)
+    static int box(const CallArg& value, mp_embed_obj_t* result);
+    static int argumentCountError(size_t expected, size_t given);
+    static int argumentTypeError(size_t index);
+    static int raise(const char* message);
+
+    // Deduce the signature of a callable
+    template <typename T>
+    struct Signature : Signature<decltype(&T::operator())> {};
+
+    template <typename R, typename... Args>
+    struct Signature<R (*)(Args...)> {
+        template <typename F>
+        static Trampoline trampoline() {
+            return &NativeModule::call<F, R, Args...>;
+        }
+    };
+
+    template <typename R, typename... Args>
+    struct Signature<R (*)(Args...) noexcept> : Signature<R (*)(Args...)> {};
+
+    template <typename C, typename R, typename... Args>
+    struct Signature<R (C::*)(Args...)> : Signature<R (*)(Args...)> {};
+
+    template <typename C, typename R, typename... Args>
+    struct Signature<R (C::*)(Args...) const> : Signature<R (*)(Args...)> {};
+
+    template <typename C, typename R, typename... Args>
+    struct Signature<R (C::*)(Args...) noexcept> : Signature<R (*)(Args...)> {};
+
+    template <typename C, typename R, typename... Args>
+    struct Signature<R (C::*)(Args...) const noexcept> : Signature<R (*)(Args...)> {};
+
+    template <typename F, typename R, typename... Args>
+    static int call(void* data, size_t n_args, const mp_embed_obj_t* args, mp_embed_obj_t* result) {
+        if (n_args != sizeof...(Args)) {
+            return argumentCountError(sizeof...(Args), n_args);
+        }
+        return invoke<F, R, Args...>(*static_cast<F*>(data), args, result,
+                                     std::index_sequence_for<Args...>());
+    }
+
+    template <typename F, typename R, typename... Args, size_t... I>
+    static int invoke(F& function, const mp_embed_obj_t* args, mp_embed_obj_t* result,
+                      std::index_sequence<I...>) {
+        (void)args;
+        // Exceptions must not unwind through the VM
+        try {
+            std::tuple<typename std::decay<Args>::type...> values;
+            size_t failed = 0;
+            bool unboxed = (true && ... &&
+                (ResultConverter<typename std::decay<Args>::type>::convert(PythonValue(args[I]), std::get<I>(values))
+                 || (failed = I, false)));
+            if (!unboxed) {
+                return argumentTypeError(failed);
+            }
+
+            if constexpr (std::is_void<R>::value) {
+                function(std::move(std::get<I>(values))...);
+                *result = MP_EMBED_OBJ_NONE;
+                return Ok;
+            } else {
+                typename std::decay<R>::type value = function(std::move(std::get<I>(values))...);
+                CallArg boxed;
+                ArgConverter<typename std::decay<R>::type>::convert(value, boxed);
+                return box(boxed, result);
+            }
+        } catch (const std::exception& e) {
+            return raise(e.what());
+        } catch (...) {
+            return raise("unknown C++ exception");
+        }
+    }
+
+    MicroPythonEngine& engine_;
+    std::string name_;
+    std::vector<Function> functions_;
+
+    NativeModule(const NativeModule&) = delete;
+    NativeModule& operator=(const NativeModule&) = delete;
+};
+
+#endif // MICROPYTHON_MODULE_H
@@ -0,0 +1,156 @@
+/*
+ * MicroPython Object Handles
+ *
+ * Object handles as seen through the embed API. The encoding mirrors the
+ * port's object representation (MICROPY_OBJ_REPR_A with immediate
+ * objects, or MICROPY_OBJ_REPR_D when built with MP_EMBED_NAN_BOXING), so
+ * small ints, bools, None and with NaN boxing floats can be built and
+ * decoded inline, without calling into the runtime or allocating. Shared
+ * by the C runtime and the C++ wrapper, which must agree on
+ * MP_EMBED_NAN_BOXING.
+ */
+
+#ifndef MICROPYTHON_OBJREPR_H
+#define MICROPYTHON_OBJREPR_H
+
+#include <stdint.h>
+
+#ifndef MP_EMBED_NAN_BOXING
+#define MP_EMBED_NAN_BOXING 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if MP_EMBED_NAN_BOXING
+
+/*
+ * MICROPY_OBJ_REPR_D: 64-bit objects with NaN boxing. A double R is stored
+ * as R + 0x8004000000000000, which leaves pointers with the top 16 bits
+ * clear and moves the remaining NaN space up to hold the other immediates:
+ *   0x0000 pppp pppp pppp   pointer
+ *   0x0001 iiii iiii iiii   small int (47 bits, LSB set)
+ *   0x0003 ss00 0000 0000   immediate object
+ *   anything else           float
+ * Floats are immediate too, so they never touch the heap.
+ */
+typedef uint64_t mp_embed_obj_t;
+typedef int64_t mp_embed_small_int_t;
+
+#define MP_EMBED_OBJ_NULL       ((mp_embed_obj_t)0)
+
+// Immediate objects: (value << 46) | 0x0003000000000000
+#define MP_EMBED_OBJ_NONE       ((mp_embed_obj_t)0x0003000000000000ULL)
+#define MP_EMBED_OBJ_FALSE      ((mp_embed_obj_t)0x0003400000000000ULL)
+#define MP_EMBED_OBJ_TRUE       ((mp_embed_obj_t)0x0003c00000000000ULL)
+
+#define MP_EMBED_SMALL_INT_MIN  (-((int64_t)1 << 46))
+#define MP_EMBED_SMALL_INT_MAX  (((int64_t)1 << 46) - 1)
+
+#define MP_EMBED_FLOAT_OFFSET   0x8004000000000000ULL
+
+static inline int mp_embed_obj_is_small_int(mp_embed_obj_t obj) {
+    return (obj & 0xffff000000000001ULL) == 0x0001000000000001ULL;
+}
+
+static inline mp_embed_obj_t mp_embed_obj_from_small_int(mp_embed_small_int_t value) {
+    return (((uint64_t)value & 0x7fffffffffffULL) << 1) | 0x0001000000000001ULL;
+}
+
+static inline mp_embed_small_int_t mp_embed_obj_small_int_value(mp_embed_obj_t obj) {
+    return (int64_t)(obj << 16) >> 17;
+}
+
+static inline int mp_embed_obj_is_float(mp_embed_obj_t obj) {
+    return (obj & 0xfffc000000000000ULL) != 0;
+}
+
+static inline mp_embed_obj_t mp_embed_obj_from_float(double value) {
+    // NaNs with a payload would alias the other immediates
+    union { double f; uint64_t r; } num;
+    num.f = value;
+    if (value != value) {
+        num.r = 0x7ff8000000000000ULL;
+    }
+    return num.r + MP_EMBED_FLOAT_OFFSET;
+}
+
+static inline double mp_embed_obj_float_value(mp_embed_obj_t obj) {
+    union { double f; uint64_t r; } num;
+    num.r = obj - MP_EMBED_FLOAT_OFFSET;
+    return num.f;
+}
+
+// Pointer to a heap/ROM object
+static inline int mp_embed_obj_is_obj(mp_embed_obj_t obj) {
+    return (obj & 0xffff000000000000ULL) == 0;
+}
+
+#else
+
+// mp_obj_t: a pointer to a heap/ROM object, or an immediate value
+typedef uintptr_t mp_embed_obj_t;
+typedef intptr_t mp_embed_small_int_t;
+
+#define MP_EMBED_OBJ_NULL       ((mp_embed_obj_t)0)
+
+// Immediate objects: (value << 3) | 6
+#define MP_EMBED_OBJ_NONE       ((mp_embed_obj_t)((0 << 3) | 6))
+#define MP_EMBED_OBJ_FALSE      ((mp_embed_obj_t)((1 << 3) | 6))
+#define MP_EMBED_OBJ_TRUE       ((mp_embed_obj_t)((3 << 3) | 6))
+
+// Small ints: (value << 1) | 1, so one bit narrower than a machine word
+#define MP_EMBED_SMALL_INT_MIN  (INTPTR_MIN / 2)
+#define MP_EMBED_SMALL_INT_MAX  (INTPTR_MAX / 2)
+
+static inline int mp_embed_obj_is_small_int(mp_embed_obj_t obj) {
+    return (obj & 1) != 0;
+}
+
+static inline mp_embed_obj_t mp_embed_obj_from_small_int(mp_embed_small_int_t value) {
+    return ((uintptr_t)value << 1) | 1;
+}
+
+static inline mp_embed_small_int_t mp_embed_obj_small_int_value(mp_embed_obj_t obj) {
+    return (intptr_t)obj >> 1;
+}
+
+// Floats are heap objects in this representation
+static inline int mp_embed_obj_is_float(mp_embed_obj_t obj) {
+    (void)obj;
+    return 0;
+}
+
+// Pointer to a heap/ROM object
+static inline int mp_embed_obj_is_obj(mp_embed_obj_t obj) {
+    return (obj & 3) == 0;
+}
+
+#endif // MP_EMBED_NAN_BOXING
+
+static inline int mp_embed_small_int_fits(long long value) {
+    return value >= MP_EMBED_SMALL_INT_MIN && value <= MP_EMBED_SMALL_INT_MAX;
+}
+
+static inline mp_embed_obj_t mp_embed_obj_from_ptr(const void *ptr) {
+    return (mp_embed_obj_t)(uintptr_t)ptr;
+}
+
+static inline void *mp_embed_obj_to_ptr(mp_embed_obj_t obj) {
+    return (void *)(uintptr_t)obj;
+}
+
+static inline mp_embed_obj_t mp_embed_obj_from_bool(int value) {
+    return value ? MP_EMBED_OBJ_TRUE : MP_EMBED_OBJ_FALSE;
+}
+
+static inline int mp_embed_obj_is_bool(mp_embed_obj_t obj) {
+    return obj == MP_EMBED_OBJ_TRUE || obj == MP_EMBED_OBJ_FALSE;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MICROPYTHON_OBJREPR_H
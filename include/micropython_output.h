@@ -0,0 +1,104 @@
+#ifndef MICROPYTHON_OUTPUT_H
+#define MICROPYTHON_OUTPUT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+/**
+ * Destination of script output (print(), tracebacks)
+ *
+ * write() is called on the thread running the script, with the engine
+ * locked, so an engine never writes to its sink from two threads at once.
+ * A sink shared between engines must do its own synchronization.
+ */
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+
+    /**
+     * Consume a chunk of output
+     * @param data Output bytes (not NUL-terminated)
+     * @param len Number of bytes
+     */
+    virtual void write(const char* data, size_t len) = 0;
+};
+
+/**
+ * Lock-free single-producer single-consumer ring buffer (the default sink)
+ *
+ * The engine writes without locks or syscalls; the host drains the output
+ * in bulk from any one thread. When the ring is full a write is dropped
+ * whole (never blocking the script) and counted in dropped().
+ */
+class RingBufferSink : public OutputSink {
+public:
+    static constexpr size_t DefaultCapacity = 64 * 1024;
+
+    /**
+     * @param capacity Ring size in bytes, rounded up to a power of two
+     */
+    explicit RingBufferSink(size_t capacity = DefaultCapacity);
+
+    void write(const char* data, size_t len) override;
+
+    /**
+     * Move buffered output out of the ring (consumer thread only)
+     * @param out Destination
+     * @param max Capacity of out
+     * @return Bytes copied
+     */
+    size_t read(char* out, size_t max);
+
+    /**
+     * Move all buffered output out of the ring (consumer thread only)
+     * @return Buffered output
+     */
+    std::string drain();
+
+    /**
+     * Bytes currently buffered
+     */
+    size_t size() const;
+
+    /**
+     * Bytes dropped because the ring was full
+     */
+    uint64_t dropped() const;
+
+private:
+    std::unique_ptr<char[]> buffer_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> head_{0};   // Total bytes written (producer)
+    alignas(64) std::atomic<size_t> tail_{0};   // Total bytes read (consumer)
+    std::atomic<uint64_t> dropped_{0};
+};
+
+/**
+ * Writes output straight to stdout (one fwrite per chunk)
+ */
+class StdoutSink : public OutputSink {
+public:
+    void write(const char* data, size_t len) override;
+};
+
+/**
+ * Severity of an engine diagnostic
+ */
+enum class LogLevel {
+    Off,        // Log nothing
+    Error,      // Failures the engine recovered from
+    Warning,
+    Info,       // Lifecycle: initialize, shutdown, snapshots
+    Debug       // Per-execution tracing
+};
+
+/**
+ * Receives engine diagnostics at or above the configured level
+ */
+using LogHandler = std::function<void(LogLevel level, const std::string& message)>;
+
+#endif // MICROPYTHON_OUTPUT_H
@@ -0,0 +1,329 @@
+#ifndef MICROPYTHON_VALUE_H
+#define MICROPYTHON_VALUE_H
+
+#include "micropython_objrepr.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Argument of MicroPythonEngine::call(), described without touching the VM
+ *
+ * Small ints, bools and None (and floats when built with NaN boxing) are
+ * encoded inline as Object, so passing them never allocates. Everything
+ * else is turned into a Python object by the engine once the call is
+ * under way.
+ */
+struct CallArg {
+    enum class Kind { Object, Int, Float, String, List };
+    using ElementFn = void (*)(const void* sequence, size_t index, CallArg& out);
+
+    Kind kind = Kind::Object;
+    union {
+        mp_embed_obj_t object;
+        long long integer;
+        double real;
+        struct {
+            const char* data;
+            size_t size;
+        } string;
+        struct {
+            const void* data;       // The C++ container
+            size_t size;
+            ElementFn element;      // Describes element i of the container
+        } list;
+    };
+
+    CallArg() : object(MP_EMBED_OBJ_NONE) {}
+};
+
+/**
+ * Converts a C++ argument into a CallArg; specialize to support more types
+ */
+template <typename T, typename Enable = void>
+struct ArgConverter;
+
+template <>
+struct ArgConverter<bool> {
+    static void convert(bool value, CallArg& out) {
+        out.kind = CallArg::Kind::Object;
+        out.object = mp_embed_obj_from_bool(value);
+    }
+};
+
+template <typename T>
+struct ArgConverter<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+    static void convert(T value, CallArg& out) {
+        bool small = std::is_unsigned<T>::value
+            ? static_cast<unsigned long long>(value) <= static_cast<unsigned long long>(MP_EMBED_SMALL_INT_MAX)
+            : mp_embed_small_int_fits(static_cast<long long>(value));
+        if (small) {
+            out.kind = CallArg::Kind::Object;
+            out.object = mp_embed_obj_from_small_int(static_cast<mp_embed_small_int_t>(value));
+        } else {
+            out.kind = CallArg::Kind::Int;
+            out.integer = static_cast<long long>(value);
+        }
+    }
+};
+
+template <typename T>
+struct ArgConverter<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static void convert(T value, CallArg& out) {
+#if MP_EMBED_NAN_BOXING
+        out.kind = CallArg::Kind::Object;
+        out.object = mp_embed_obj_from_float(static_cast<double>(value));
+#else
+        out.kind = CallArg::Kind::Float;
+        out.real = static_cast<double>(value);
+#endif
+    }
+};
+
+template <>
+struct ArgConverter<std::string_view> {
+    static void convert(std::string_view value, CallArg& out) {
+        out.kind = CallArg::Kind::String;
+        out.string.data = value.data();
+        out.string.size = value.size();
+    }
+};
+
+template <>
+struct ArgConverter<std::string> : ArgConverter<std::string_view> {};
+
+template <>
+struct ArgConverter<const char*> : ArgConverter<std::string_view> {};
+
+template <>
+struct ArgConverter<char*> : ArgConverter<std::string_view> {};
+
+template <>
+struct ArgConverter<std::nullptr_t> {
+    static void convert(std::nullptr_t, CallArg& out) {
+        out.kind = CallArg::Kind::Object;
+        out.object = MP_EMBED_OBJ_NONE;
+    }
+};
+
+// Contiguous containers become Python lists
+template <typename Container, typename Element>
+struct SequenceArgConverter {
+    static void convert(const Container& value, CallArg& out) {
+        out.kind = CallArg::Kind::List;
+        out.list.data = &value;
+        out.list.size = value.size();
+        out.list.element = [](const void* sequence, size_t index, CallArg& element) {
+            const Container& container = *static_cast<const Container*>(sequence);
+            ArgConverter<Element>::convert(container[index], element);
+        };
+    }
+};
+
+template <typename T, typename Allocator>
+struct ArgConverter<std::vector<T, Allocator>>
+    : SequenceArgConverter<std::vector<T, Allocator>, T> {};
+
+template <typename T, size_t N>
+struct ArgConverter<std::array<T, N>>
+    : SequenceArgConverter<std::array<T, N>, T> {};
+
+/**
+ * Unpacks one input of MicroPythonEngine::callBatch() into arguments:
+ * std::tuple and std::pair supply one argument per element, any other
+ * type is a single argument
+ */
+template <typename T>
+struct BatchArgs {
+    static constexpr size_t count = 1;
+
+    static void convert(const T& value, CallArg* out) {
+        ArgConverter<T>::convert(value, out[0]);
+    }
+};
+
+template <typename... Ts>
+struct BatchArgs<std::tuple<Ts...>> {
+    static constexpr size_t count = sizeof...(Ts);
+
+    static void convert(const std::tuple<Ts...>& value, CallArg* out) {
+        convert(value, out, std::index_sequence_for<Ts...>());
+    }
+
+private:
+    template <size_t... I>
+    static void convert(const std::tuple<Ts...>& value, CallArg* out, std::index_sequence<I...>) {
+        (void)value;
+        (void)out;
+        (ArgConverter<typename std::decay<Ts>::type>::convert(std::get<I>(value), out[I]), ...);
+    }
+};
+
+template <typename A, typename B>
+struct BatchArgs<std::pair<A, B>> {
+    static constexpr size_t count = 2;
+
+    static void convert(const std::pair<A, B>& value, CallArg* out) {
+        ArgConverter<typename std::decay<A>::type>::convert(value.first, out[0]);
+        ArgConverter<typename std::decay<B>::type>::convert(value.second, out[1]);
+    }
+};
+
+/**
+ * Read-only view of a Python object returned from a call
+ *
+ * Only valid while the result is being converted (inside the engine call
+ * that produced it). Immediate values are decoded inline.
+ */
+class PythonValue {
+public:
+    explicit PythonValue(mp_embed_obj_t object) : object_(object) {}
+
+    mp_embed_obj_t object() const {
+        return object_;
+    }
+
+    bool isNone() const {
+        return object_ == MP_EMBED_OBJ_NONE;
+    }
+
+    bool toBool(bool& out) const {
+        if (mp_embed_obj_is_bool(object_)) {
+            out = object_ == MP_EMBED_OBJ_TRUE;
+            return true;
+        }
+        long long value = 0;
+        if (toInt(value)) {
+            out = value != 0;
+            return true;
+        }
+        return false;
+    }
+
+    bool toInt(long long& out) const {
+        if (mp_embed_obj_is_small_int(object_)) {
+            out = mp_embed_obj_small_int_value(object_);
+            return true;
+        }
+        return toIntSlow(out);
+    }
+
+    bool toDouble(double& out) const {
+        if (mp_embed_obj_is_small_int(object_)) {
+            out = static_cast<double>(mp_embed_obj_small_int_value(object_));
+            return true;
+        }
+#if MP_EMBED_NAN_BOXING
+        if (mp_embed_obj_is_float(object_)) {
+            out = mp_embed_obj_float_value(object_);
+            return true;
+        }
+#endif
+        return toDoubleSlow(out);
+    }
+
+    /**
+     * Check for a tuple or list
+     * @return true if item() can be used
+     */
+    bool isSequence() const;
+
+    /**
+     * Copy a str result
+     * @param out Receives the text
+     * @return false if the object is not a str
+     */
+    bool toString(std::string& out) const;
+
+    /**
+     * Get the length of a tuple, list or str
+     * @param out Receives the length
+     * @return false if the object has no length
+     */
+    bool size(size_t& out) const;
+
+    /**
+     * Get an item of a tuple or list
+     * @param index Item index (must be below size())
+     * @return View of the item
+     */
+    PythonValue item(size_t index) const;
+
+private:
+    bool toIntSlow(long long& out) const;
+    bool toDoubleSlow(double& out) const;
+
+    mp_embed_obj_t object_;
+};
+
+/**
+ * Converts a call result back into C++; specialize to support more types
+ */
+template <typename T, typename Enable = void>
+struct ResultConverter;
+
+template <>
+struct ResultConverter<bool> {
+    static bool convert(const PythonValue& value, bool& out) {
+        return value.toBool(out);
+    }
+};
+
+template <typename T>
+struct ResultConverter<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+    static bool convert(const PythonValue& value, T& out) {
+        long long wide = 0;
+        if (!value.toInt(wide) || (std::is_unsigned<T>::value && wide < 0)) {
+            return false;
+        }
+        out = static_cast<T>(wide);
+        return static_cast<long long>(out) == wide;
+    }
+};
+
+template <typename T>
+struct ResultConverter<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static bool convert(const PythonValue& value, T& out) {
+        double real = 0;
+        if (!value.toDouble(real)) {
+            return false;
+        }
+        out = static_cast<T>(real);
+        return true;
+    }
+};
+
+template <>
+struct ResultConverter<std::string> {
+    static bool convert(const PythonValue& value, std::string& out) {
+        return value.toString(out);
+    }
+};
+
+template <typename T, typename Allocator>
+struct ResultConverter<std::vector<T, Allocator>> {
+    static bool convert(const PythonValue& value, std::vector<T, Allocator>& out) {
+        size_t count = 0;
+        if (!value.isSequence() || !value.size(count)) {
+            return false;
+        }
+        out.clear();
+        out.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            T element{};
+            if (!ResultConverter<T>::convert(value.item(i), element)) {
+                return false;
+            }
+            out.push_back(std::move(element));
+        }
+        return true;
+    }
+};
+
+#endif // MICROPYTHON_VALUE_H
@@ -14,6 +14,7 @@
 #define MICROPY_ENABLE_GC                       (1)
 #endif
 #define MICROPY_ENABLE_FINALISER                (1)
+#define MICROPY_GC_ALLOC_THRESHOLD              (1)
 #define MICROPY_STACK_CHECK                     (1)
 #define MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF  (1)
 #define MICROPY_KBD_EXCEPTION                   (1)
@@ -79,6 +80,33 @@
 #define MICROPY_PERSISTENT_CODE_LOAD            (1)
 #define MICROPY_PERSISTENT_CODE_SAVE            (1)
 
+// Native code emitters for @micropython.native/@micropython.viper
+// (MICROPYTHON_NATIVE_EMITTER in CMake). Machine code goes into the
+// context's code arena, never into the GC heap, which is not executable;
+// it is writable until committed, then read/execute only.
+#ifndef MICROPY_EMIT_X64
+#define MICROPY_EMIT_X64                        (0)
+#endif
+#ifndef MICROPY_EMIT_INLINE_X64
+#define MICROPY_EMIT_INLINE_X64                 (0)
+#endif
+#if MICROPY_EMIT_X64
+void mp_embed_alloc_exec(size_t min_size, void **ptr, size_t *size);
+void *mp_embed_commit_exec(void *ptr, size_t size, void *reloc);
+void mp_embed_free_exec(void *ptr, size_t size);
+#define MP_PLAT_ALLOC_EXEC(min_size, ptr, size) mp_embed_alloc_exec(min_size, ptr, size)
+#define MP_PLAT_COMMIT_EXEC(buf, len, reloc)    mp_embed_commit_exec(buf, len, reloc)
+#define MP_PLAT_FREE_EXEC(ptr, size)            mp_embed_free_exec(ptr, size)
+#endif
+
+// Frozen modules (enabled by micropython_freeze_modules() in CMake)
+#ifndef MICROPY_MODULE_FROZEN_MPY
+#define MICROPY_MODULE_FROZEN_MPY               (0)
+#endif
+#ifndef MICROPY_MODULE_FROZEN_STR
+#define MICROPY_MODULE_FROZEN_STR               (0)
+#endif
+
 // C++ integration specific
 #define MICROPY_ENABLE_EXTERNAL_IMPORT          (1)
 #define MICROPY_READER_POSIX                    (1)
@@ -108,6 +136,15 @@ extern const char cpp_embed_help_text[];
 // Float precision
 #define MICROPY_FLOAT_IMPL                      (MICROPY_FLOAT_IMPL_DOUBLE)
 
+// Object representation: with NaN boxing floats are immediate values
+// instead of heap objects (needs MICROPY_FLOAT_IMPL_DOUBLE)
+#ifndef MP_EMBED_NAN_BOXING
+#define MP_EMBED_NAN_BOXING                     (0)
+#endif
+#if MP_EMBED_NAN_BOXING
+#define MICROPY_OBJ_REPR                        (MICROPY_OBJ_REPR_D)
+#endif
+
 // Enable debugging features in debug builds
 #ifdef DEBUG
     #define MICROPY_DEBUG_VERBOSE               (1)
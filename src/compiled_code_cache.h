@@ -0,0 +1,172 @@
+#ifndef COMPILED_CODE_CACHE_H
+#define COMPILED_CODE_CACHE_H
+
+#include "mapped_file.h"
+#include "micropython_engine.h"
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * LRU cache of compiled scripts
+ *
+ * Source strings are keyed by a hash of their content and source name
+ * (the name ends up in tracebacks), files by their path and are valid
+ * while the file's stamp (mtime, size, inode) matches. The full identity
+ * (source text and name, or path) is kept with every entry so a hash
+ * collision is treated as a miss and can never run the wrong code.
+ */
+template <typename Compiled>
+class CompiledCodeCache {
+public:
+    explicit CompiledCodeCache(size_t capacity = 0)
+        : capacity_(capacity) {}
+
+    /**
+     * Change the maximum number of entries, evicting the oldest if needed
+     * @param capacity New capacity (0 disables the cache)
+     */
+    void setCapacity(size_t capacity) {
+        capacity_ = capacity;
+        trim();
+    }
+
+    /**
+     * Check whether caching is enabled
+     * @return true if capacity is non-zero
+     */
+    bool enabled() const {
+        return capacity_ > 0;
+    }
+
+    /**
+     * Look up compiled code by source content
+     * @param source Python source text
+     * @param name Source name the code was compiled with
+     * @return Compiled code, or nullptr on a miss
+     */
+    Compiled findSource(std::string_view source, std::string_view name) {
+        return find(Kind::Source, source, name, FileStamp());
+    }
+
+    /**
+     * Store compiled code for a source string
+     * @param source Python source text
+     * @param name Source name the code was compiled with
+     * @param compiled Compiled code
+     */
+    void insertSource(std::string_view source, std::string_view name, Compiled compiled) {
+        insert(Kind::Source, source, name, FileStamp(), std::move(compiled));
+    }
+
+    /**
+     * Look up compiled code for a file
+     * @param path File path
+     * @param stamp Stamp of the file on disk
+     * @return Compiled code, or nullptr on a miss or a stale entry
+     */
+    Compiled findFile(std::string_view path, const FileStamp& stamp) {
+        return find(Kind::File, path, std::string_view(), stamp);
+    }
+
+    /**
+     * Store compiled code for a file
+     * @param path File path
+     * @param stamp Stamp of the contents the code was compiled from
+     * @param compiled Compiled code
+     */
+    void insertFile(std::string_view path, const FileStamp& stamp, Compiled compiled) {
+        insert(Kind::File, path, std::string_view(), stamp, std::move(compiled));
+    }
+
+    /**
+     * Drop all entries (counters are kept)
+     */
+    void clear() {
+        index_.clear();
+        entries_.clear();
+    }
+
+    /**
+     * Get cache counters
+     * @return Snapshot of hit/miss/eviction counters
+     */
+    CodeCacheStats stats() const {
+        CodeCacheStats result = stats_;
+        result.entries = entries_.size();
+        result.capacity = capacity_;
+        return result;
+    }
+
+private:
+    enum class Kind { Source, File };
+
+    struct Entry {
+        Kind kind;
+        uint64_t hash;
+        std::string identity;
+        std::string name;           // Source name (source strings only)
+        FileStamp stamp;
+        Compiled compiled;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    static uint64_t hashOf(Kind kind, std::string_view identity, std::string_view name) {
+        uint64_t hash = std::hash<std::string_view>()(identity);
+        hash ^= std::hash<std::string_view>()(name) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+        return kind == Kind::File ? ~hash : hash;
+    }
+
+    Compiled find(Kind kind, std::string_view identity, std::string_view name, const FileStamp& stamp) {
+        if (!enabled()) {
+            return Compiled();
+        }
+        auto it = index_.find(hashOf(kind, identity, name));
+        if (it == index_.end() || it->second->kind != kind || it->second->identity != identity ||
+            it->second->name != name || it->second->stamp != stamp) {
+            stats_.misses++;
+            return Compiled();
+        }
+        // Move to the front (most recently used)
+        entries_.splice(entries_.begin(), entries_, it->second);
+        stats_.hits++;
+        return it->second->compiled;
+    }
+
+    void insert(Kind kind, std::string_view identity, std::string_view name, const FileStamp& stamp,
+                Compiled compiled) {
+        if (!enabled()) {
+            return;
+        }
+        uint64_t hash = hashOf(kind, identity, name);
+        auto it = index_.find(hash);
+        if (it != index_.end()) {
+            // Stale file entry or hash collision: replace in place
+            entries_.erase(it->second);
+            index_.erase(it);
+        }
+        entries_.push_front(Entry{kind, hash, std::string(identity), std::string(name), stamp, std::move(compiled)});
+        index_[hash] = entries_.begin();
+        trim();
+    }
+
+    void trim() {
+        while (entries_.size() > capacity_) {
+            index_.erase(entries_.back().hash);
+            entries_.pop_back();
+            stats_.evictions++;
+        }
+    }
+
+    size_t capacity_;
+    EntryList entries_;
+    std::unordered_map<uint64_t, typename EntryList::iterator> index_;
+    CodeCacheStats stats_;
+};
+
+#endif // COMPILED_CODE_CACHE_H
@@ -0,0 +1,450 @@
+#include "engine_pool.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#ifdef __linux__
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Job {
+    EnginePool::Task task;
+    std::promise<ExecutionResult> promise;
+    Clock::time_point submitted;
+};
+
+/**
+ * Lock-free latency histogram with power-of-two nanosecond buckets
+ */
+class LatencyHistogram {
+public:
+    void record(std::chrono::nanoseconds latency) {
+        uint64_t ns = static_cast<uint64_t>(std::max<int64_t>(latency.count(), 1));
+        size_t bucket = 0;
+        while (bucket + 1 < buckets.size() && (uint64_t(1) << bucket) < ns) {
+            bucket++;
+        }
+        buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Upper bound of the bucket holding the given percentile
+    std::chrono::nanoseconds percentile(double p) const {
+        uint64_t total = 0;
+        for (const auto& bucket : buckets) {
+            total += bucket.load(std::memory_order_relaxed);
+        }
+        if (total == 0) {
+            return std::chrono::nanoseconds(0);
+        }
+        uint64_t rank = static_cast<uint64_t>(p * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets.size(); i++) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return std::chrono::nanoseconds(int64_t(1) << i);
+            }
+        }
+        return std::chrono::nanoseconds(int64_t(1) << (buckets.size() - 1));
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, 48> buckets{};
+};
+
+ExecutionResult failedResult(const std::string& error, ErrorCode code) {
+    ExecutionResult result;
+    result.error = error;
+    result.code = code;
+    return result;
+}
+
+std::future<ExecutionResult> readyResult(const std::string& error, ErrorCode code) {
+    std::promise<ExecutionResult> promise;
+    promise.set_value(failedResult(error, code));
+    return promise.get_future();
+}
+
+} // namespace
+
+/**
+ * Private implementation class using PIMPL idiom
+ */
+class EnginePool::Impl {
+public:
+    struct Worker {
+        std::thread thread;
+        MicroPythonEngine engine;
+        std::mutex mutex;           // Guards jobs
+        std::deque<Job> jobs;
+        int cpu = -1;
+
+        std::atomic<size_t> completed{0};
+        std::atomic<size_t> failed{0};
+        std::atomic<size_t> stolen{0};
+        std::atomic<uint64_t> totalLatency{0};
+        std::atomic<uint64_t> maxLatency{0};
+        std::atomic<uint64_t> totalWait{0};
+        LatencyHistogram histogram;
+    };
+
+    EnginePoolConfig config;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    std::atomic<size_t> queued{0};        // Reserved queue slots
+    std::atomic<size_t> nextWorker{0};    // Round-robin cursor
+    std::atomic<bool> stopping{false};
+    std::mutex wakeMutex;
+    std::condition_variable wakeCv;       // Workers wait here for jobs
+    std::condition_variable spaceCv;      // Blocked submitters wait here
+    std::mutex joinMutex;                 // Serializes joining the workers
+
+    // Worker the calling thread belongs to, if it is one of ours
+    static thread_local Impl* currentPool;
+    static thread_local size_t currentWorker;
+
+    // Pool diagnostics go through the engines' log settings
+    void log(LogLevel level, const std::string& message) {
+        if (level == LogLevel::Off || level > config.engine.log_level) {
+            return;
+        }
+        if (config.engine.log_handler) {
+            config.engine.log_handler(level, message);
+        } else {
+            std::cerr << message << std::endl;
+        }
+    }
+
+    // Reserve a queue slot according to the overflow policy
+    bool reserveSlot() {
+        size_t current = queued.load();
+        while (true) {
+            if (current < config.queue_capacity) {
+                if (queued.compare_exchange_weak(current, current + 1)) {
+                    return true;
+                }
+                continue;
+            }
+            // A worker waiting for space would hold the slot-releasing
+            // worker itself, and with every worker doing so nothing drains
+            if (config.overflow == OverflowPolicy::Reject || currentPool == this) {
+                return false;
+            }
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            spaceCv.wait(lock, [this] {
+                return queued.load() < config.queue_capacity || stopping.load();
+            });
+            if (stopping.load()) {
+                return false;
+            }
+            current = queued.load();
+        }
+    }
+
+    // Release a queue slot once a job has been taken off a deque
+    void releaseSlot() {
+        queued.fetch_sub(1);
+        if (config.overflow == OverflowPolicy::Block) {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            spaceCv.notify_one();
+        }
+    }
+
+    std::future<ExecutionResult> enqueue(Task task) {
+        if (stopping.load()) {
+            return readyResult("Engine pool is shut down", ErrorCode::InvalidState);
+        }
+        if (!reserveSlot()) {
+            if (stopping.load()) {
+                return readyResult("Engine pool is shut down", ErrorCode::InvalidState);
+            }
+            return readyResult("Engine pool queue is full", ErrorCode::ResourceError);
+        }
+
+        Job job;
+        job.task = std::move(task);
+        job.submitted = Clock::now();
+        std::future<ExecutionResult> future = job.promise.get_future();
+
+        // Jobs submitted from a worker stay local, others go round-robin
+        size_t target = currentPool == this
+            ? currentWorker
+            : nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+        {
+            std::lock_guard<std::mutex> lock(workers[target]->mutex);
+            workers[target]->jobs.push_back(std::move(job));
+        }
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            wakeCv.notify_one();
+        }
+        return future;
+    }
+
+    // Take the oldest job from the worker's own deque
+    bool popLocal(Worker& worker, Job& job) {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.jobs.empty()) {
+            return false;
+        }
+        job = std::move(worker.jobs.front());
+        worker.jobs.pop_front();
+        return true;
+    }
+
+    // Take the newest job from another worker's deque
+    bool steal(size_t thief, Job& job) {
+        for (size_t i = 1; i < workers.size(); i++) {
+            Worker& victim = *workers[(thief + i) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.jobs.empty()) {
+                job = std::move(victim.jobs.back());
+                victim.jobs.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(Worker& worker, Job& job) {
+        Clock::time_point start = Clock::now();
+        ExecutionResult result;
+        try {
+            result = job.task(worker.engine);
+        } catch (const std::exception& e) {
+            result = failedResult(std::string("Job failed: ") + e.what(), ErrorCode::Internal);
+        }
+        Clock::time_point end = Clock::now();
+
+        auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+        auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(start - job.submitted);
+        uint64_t latencyNs = static_cast<uint64_t>(latency.count());
+        worker.completed.fetch_add(1, std::memory_order_relaxed);
+        if (!result.success) {
+            worker.failed.fetch_add(1, std::memory_order_relaxed);
+        }
+        worker.totalLatency.fetch_add(latencyNs, std::memory_order_relaxed);
+        worker.totalWait.fetch_add(static_cast<uint64_t>(wait.count()), std::memory_order_relaxed);
+        uint64_t max = worker.maxLatency.load(std::memory_order_relaxed);
+        while (latencyNs > max &&
+               !worker.maxLatency.compare_exchange_weak(max, latencyNs, std::memory_order_relaxed)) {
+        }
+        worker.histogram.record(latency);
+
+        job.promise.set_value(std::move(result));
+    }
+
+    void pin(Worker& worker, size_t index) {
+#ifdef __linux__
+        // Spread over the CPUs the process may run on (cgroup or taskset
+        // limits), not CPU 0..n-1
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+            log(LogLevel::Warning, "Worker " + std::to_string(index) +
+                " not pinned: sched_getaffinity failed: " + std::strerror(errno));
+            return;
+        }
+        int count = CPU_COUNT(&allowed);
+        if (count == 0) {
+            return;
+        }
+        size_t nth = index % static_cast<size_t>(count);
+        int cpu = 0;
+        for (; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &allowed) && nth-- == 0) {
+                break;
+            }
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (error != 0) {
+            log(LogLevel::Warning, "Worker " + std::to_string(index) + " not pinned to CPU " +
+                std::to_string(cpu) + ": " + std::strerror(error));
+            return;
+        }
+        worker.cpu = cpu;
+#else
+        (void)worker;
+        (void)index;
+#endif
+    }
+
+    void workerLoop(size_t index, std::promise<std::string>& ready) {
+        Worker& worker = *workers[index];
+        currentPool = this;
+        currentWorker = index;
+
+        if (config.pin_workers) {
+            pin(worker, index);
+        }
+
+        if (!worker.engine.initialize(config.engine)) {
+            ready.set_value(worker.engine.getLastError());
+            return;
+        }
+        ready.set_value(std::string());
+
+        while (true) {
+            Job job;
+            bool found = popLocal(worker, job);
+            if (!found && steal(index, job)) {
+                found = true;
+                worker.stolen.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (found) {
+                releaseSlot();
+                run(worker, job);
+                continue;
+            }
+
+            // Idle: let the engine run a deferred collection before sleeping
+            worker.engine.collectIfIdle();
+
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            if (stopping.load() && queued.load() == 0) {
+                break;
+            }
+            wakeCv.wait(lock, [this] {
+                return queued.load() > 0 || stopping.load();
+            });
+        }
+
+        worker.engine.shutdown();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping.store(true);
+        }
+        wakeCv.notify_all();
+        spaceCv.notify_all();
+
+        // A worker cannot join itself; the owner joins in a later
+        // shutdown() or the destructor
+        if (currentPool == this) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(joinMutex);
+        for (auto& worker : workers) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+    }
+};
+
+thread_local EnginePool::Impl* EnginePool::Impl::currentPool = nullptr;
+thread_local size_t EnginePool::Impl::currentWorker = 0;
+
+// Constructor
+EnginePool::EnginePool(const EnginePoolConfig& config)
+    : pImpl(std::make_unique<Impl>()) {
+    pImpl->config = config;
+    size_t count = config.workers;
+    if (count == 0) {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        pImpl->workers.push_back(std::make_unique<Impl::Worker>());
+    }
+
+    // Start workers and wait until every engine is initialized
+    std::vector<std::promise<std::string>> ready(count);
+    for (size_t i = 0; i < count; i++) {
+        pImpl->workers[i]->thread = std::thread([this, i, &ready] {
+            pImpl->workerLoop(i, ready[i]);
+        });
+    }
+
+    std::string error;
+    for (size_t i = 0; i < count; i++) {
+        std::string workerError = ready[i].get_future().get();
+        if (!workerError.empty() && error.empty()) {
+            error = "Worker " + std::to_string(i) + " failed to initialize: " + workerError;
+        }
+    }
+    if (!error.empty()) {
+        pImpl->stop();
+        throw MicroPythonException(error);
+    }
+}
+
+// Destructor
+EnginePool::~EnginePool() {
+    shutdown();
+}
+
+// Queue Python code for execution
+std::future<ExecutionResult> EnginePool::submit(std::string code) {
+    return pImpl->enqueue([code = std::move(code)](MicroPythonEngine& engine) {
+        ExecutionResult result;
+        result.success = engine.executeString(code);
+        if (!result.success) {
+            result.error = engine.getLastError();
+            result.code = engine.getLastErrorCode();
+        }
+        return result;
+    });
+}
+
+// Queue an arbitrary job
+std::future<ExecutionResult> EnginePool::submitTask(Task task) {
+    if (!task) {
+        return readyResult("Empty task", ErrorCode::InvalidArgument);
+    }
+    return pImpl->enqueue(std::move(task));
+}
+
+// Stop accepting jobs and join workers
+void EnginePool::shutdown() {
+    pImpl->stop();
+}
+
+// Get number of workers
+size_t EnginePool::size() const {
+    return pImpl->workers.size();
+}
+
+// Get number of queued jobs
+size_t EnginePool::pending() const {
+    return pImpl->queued.load();
+}
+
+// Get per-worker statistics
+std::vector<WorkerStats> EnginePool::getWorkerStats() const {
+    std::vector<WorkerStats> result;
+    for (const auto& worker : pImpl->workers) {
+        WorkerStats stats;
+        stats.jobs_completed = worker->completed.load(std::memory_order_relaxed);
+        stats.jobs_failed = worker->failed.load(std::memory_order_relaxed);
+        stats.jobs_stolen = worker->stolen.load(std::memory_order_relaxed);
+        stats.cpu = worker->cpu;
+        if (stats.jobs_completed > 0) {
+            stats.mean_latency = std::chrono::nanoseconds(
+                worker->totalLatency.load(std::memory_order_relaxed) / stats.jobs_completed);
+            stats.mean_queue_wait = std::chrono::nanoseconds(
+                worker->totalWait.load(std::memory_order_relaxed) / stats.jobs_completed);
+        }
+        stats.p50_latency = worker->histogram.percentile(0.50);
+        stats.p99_latency = worker->histogram.percentile(0.99);
+        stats.max_latency = std::chrono::nanoseconds(worker->maxLatency.load(std::memory_order_relaxed));
+        result.push_back(stats);
+    }
+    return result;
+}
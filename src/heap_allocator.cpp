@@ -0,0 +1,299 @@
+#include "heap_allocator.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define HEAP_HAVE_MMAP 1
+#else
+#define HEAP_HAVE_MMAP 0
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#if HEAP_HAVE_MMAP && defined(__linux__) && !defined(MAP_FIXED_NOREPLACE)
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+namespace {
+
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+size_t roundUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+size_t pageSize() {
+#if HEAP_HAVE_MMAP
+    long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? static_cast<size_t>(size) : 4096;
+#else
+    return 4096;
+#endif
+}
+
+} // namespace
+
+// Allocate a heap, reusing the current one when nothing changed
+bool HeapAllocation::acquire(const MicroPythonConfig& config, std::string& error) {
+    if (config.heap_size == 0) {
+        error = "Heap size must be non-zero";
+        return false;
+    }
+    if (matches(config)) {
+        if (config.heap_prefault && !prefaulted_) {
+            prefault();
+        }
+        return true;
+    }
+    release();
+
+    strategy_ = config.heap_strategy;
+    numaNode_ = config.heap_numa_node;
+    bool mapped = strategy_ != HeapStrategy::New && strategy_ != HeapStrategy::UserBuffer;
+    if (numaNode_ >= 0 && !mapped) {
+        error = "heap_numa_node requires an mmap heap strategy";
+        return false;
+    }
+
+    if (strategy_ == HeapStrategy::UserBuffer) {
+        if (!config.heap_buffer) {
+            error = "HeapStrategy::UserBuffer requires heap_buffer";
+            return false;
+        }
+        data_ = static_cast<char*>(config.heap_buffer);
+    } else if (strategy_ == HeapStrategy::New) {
+        // Page-aligned so a snapshot of the heap can be mapped back in place
+        data_ = static_cast<char*>(::operator new[](config.heap_size, std::align_val_t(pageSize()), std::nothrow));
+        if (!data_) {
+            error = "Failed to allocate heap memory";
+            return false;
+        }
+    } else if (!map(config, error)) {
+        release();
+        return false;
+    }
+    size_ = config.heap_size;
+
+    // Bind before the first touch so pages are allocated on the node
+    if (numaNode_ >= 0 && !bindNode(numaNode_, error)) {
+        release();
+        return false;
+    }
+    if (config.heap_prefault && !prefaulted_) {
+        prefault();
+    }
+    return true;
+}
+
+// Map a heap image copy-on-write at its original address
+bool HeapAllocation::mapFile(int fd, uint64_t offset, void* address, size_t size, std::string& error) {
+    release();
+#if HEAP_HAVE_MMAP
+    int flags = MAP_PRIVATE;
+#ifdef MAP_FIXED_NOREPLACE
+    flags |= MAP_FIXED_NOREPLACE;
+#endif
+    // No MAP_POPULATE: prefaulting a private writable mapping breaks COW
+    void* mapping = mmap(address, size, PROT_READ | PROT_WRITE, flags, fd, static_cast<off_t>(offset));
+    if (mapping == MAP_FAILED) {
+        error = errno == EEXIST
+            ? std::string("Snapshot heap address is already in use")
+            : std::string("Failed to map snapshot heap: ") + std::strerror(errno);
+        return false;
+    }
+    if (mapping != address) {
+        // Kernels without MAP_FIXED_NOREPLACE treat the address as a hint
+        munmap(mapping, size);
+        error = "Snapshot heap address is already in use";
+        return false;
+    }
+    mapping_ = mapping;
+    mappingSize_ = size;
+    data_ = static_cast<char*>(mapping);
+    size_ = size;
+    snapshot_ = true;
+    return true;
+#else
+    (void)fd;
+    (void)offset;
+    (void)address;
+    (void)size;
+    error = "Snapshots are not supported on this platform";
+    return false;
+#endif
+}
+
+// Free the heap
+void HeapAllocation::release() {
+#if HEAP_HAVE_MMAP
+    if (mapping_) {
+        munmap(mapping_, mappingSize_);
+    } else
+#endif
+    if (data_ && strategy_ == HeapStrategy::New) {
+        ::operator delete[](data_, std::align_val_t(pageSize()));
+    }
+    data_ = nullptr;
+    size_ = 0;
+    mapping_ = nullptr;
+    mappingSize_ = 0;
+    hugeTlb_ = false;
+    prefaulted_ = false;
+    snapshot_ = false;
+}
+
+// Snapshots map the heap back at its address, which mmap() needs page-aligned
+bool HeapAllocation::pageAligned() const {
+    return reinterpret_cast<uintptr_t>(data_) % pageSize() == 0;
+}
+
+// Describe the allocation after fallbacks
+std::string HeapAllocation::describe() const {
+    if (snapshot_) {
+        return "snapshot image, copy-on-write";
+    }
+    std::string description;
+    switch (strategy_) {
+    case HeapStrategy::New:
+        description = "new";
+        break;
+    case HeapStrategy::Mmap:
+        description = "mmap";
+        break;
+    case HeapStrategy::TransparentHugePages:
+        description = "mmap, transparent huge pages";
+        break;
+    case HeapStrategy::HugePages:
+        description = hugeTlb_ ? "mmap, MAP_HUGETLB" : "mmap, transparent huge pages (no MAP_HUGETLB pages)";
+        break;
+    case HeapStrategy::UserBuffer:
+        description = "user buffer";
+        break;
+    }
+    if (prefaulted_) {
+        description += ", prefaulted";
+    }
+    if (numaNode_ >= 0) {
+        description += ", NUMA node " + std::to_string(numaNode_);
+    }
+    return description;
+}
+
+bool HeapAllocation::matches(const MicroPythonConfig& config) const {
+    if (!data_ || snapshot_ || config.heap_strategy != strategy_ || config.heap_size != size_ ||
+        config.heap_numa_node != numaNode_) {
+        return false;
+    }
+    return strategy_ != HeapStrategy::UserBuffer || config.heap_buffer == data_;
+}
+
+// Create an anonymous mapping for the mmap based strategies
+bool HeapAllocation::map(const MicroPythonConfig& config, std::string& error) {
+#if HEAP_HAVE_MMAP
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#ifdef MAP_HUGETLB
+    if (strategy_ == HeapStrategy::HugePages) {
+        size_t length = roundUp(config.heap_size, HUGE_PAGE_SIZE);
+        void* mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+        if (mapping != MAP_FAILED) {
+            mapping_ = mapping;
+            mappingSize_ = length;
+            data_ = static_cast<char*>(mapping);
+            hugeTlb_ = true;
+            return true;
+        }
+        // No huge pages reserved (vm.nr_hugepages): use transparent ones
+    }
+#endif
+
+    // Huge page strategies over-allocate so the heap can start 2MB aligned
+    size_t alignment = strategy_ == HeapStrategy::Mmap ? pageSize() : HUGE_PAGE_SIZE;
+    size_t length = roundUp(config.heap_size, alignment);
+    size_t slack = alignment > pageSize() ? alignment : 0;
+
+#ifdef MAP_POPULATE
+    // Let the kernel fault in plain mappings; huge page mappings are touched
+    // after madvise() so the faults can be served with huge pages
+    if (config.heap_prefault && strategy_ == HeapStrategy::Mmap && numaNode_ < 0) {
+        flags |= MAP_POPULATE;
+        prefaulted_ = true;
+    }
+#endif
+
+    void* mapping = mmap(nullptr, length + slack, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (mapping == MAP_FAILED) {
+        error = std::string("Failed to map heap memory: ") + std::strerror(errno);
+        prefaulted_ = false;
+        return false;
+    }
+
+    char* base = static_cast<char*>(mapping);
+    char* aligned = reinterpret_cast<char*>(
+        roundUp(reinterpret_cast<uintptr_t>(base), alignment));
+    if (slack) {
+        size_t head = static_cast<size_t>(aligned - base);
+        if (head) {
+            munmap(base, head);
+        }
+        if (slack - head) {
+            munmap(aligned + length, slack - head);
+        }
+    }
+    mapping_ = aligned;
+    mappingSize_ = length;
+    data_ = aligned;
+
+#ifdef MADV_HUGEPAGE
+    if (strategy_ != HeapStrategy::Mmap) {
+        madvise(aligned, length, MADV_HUGEPAGE);
+    }
+#endif
+    return true;
+#else
+    (void)config;
+    error = "mmap heap strategies are not supported on this platform";
+    return false;
+#endif
+}
+
+// Restrict the mapping to one NUMA node (mbind(MPOL_BIND))
+bool HeapAllocation::bindNode(int node, std::string& error) {
+#if defined(__linux__) && defined(SYS_mbind)
+    constexpr int MPOL_BIND_MODE = 2;
+    constexpr unsigned MPOL_MF_MOVE_FLAG = 1 << 1;
+    constexpr int MAX_NODE = sizeof(unsigned long) * 8;
+    if (node >= MAX_NODE) {
+        error = "NUMA node out of range: " + std::to_string(node);
+        return false;
+    }
+    unsigned long mask = 1UL << node;
+    if (syscall(SYS_mbind, mapping_, mappingSize_, MPOL_BIND_MODE, &mask,
+                static_cast<unsigned long>(MAX_NODE + 1), MPOL_MF_MOVE_FLAG) != 0) {
+        error = "Failed to bind heap to NUMA node " + std::to_string(node) + ": " +
+                std::strerror(errno);
+        return false;
+    }
+    return true;
+#else
+    (void)node;
+    error = "NUMA placement is not supported on this platform";
+    return false;
+#endif
+}
+
+// Touch every page so no fault happens while scripts run
+void HeapAllocation::prefault() {
+    size_t step = hugeTlb_ ? HUGE_PAGE_SIZE : pageSize();
+    volatile char* bytes = data_;
+    for (size_t offset = 0; offset < size_; offset += step) {
+        bytes[offset] = 0;
+    }
+    prefaulted_ = true;
+}
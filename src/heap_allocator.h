@@ -0,0 +1,88 @@
+#ifndef HEAP_ALLOCATOR_H
+#define HEAP_ALLOCATOR_H
+
+#include "micropython_engine.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Memory backing a Python heap
+ *
+ * Owns the heap according to a HeapStrategy and keeps it until release(),
+ * so an engine can reuse the same (already faulted-in) pages across
+ * shutdown()/initialize() cycles.
+ */
+class HeapAllocation {
+public:
+    HeapAllocation() = default;
+    ~HeapAllocation() {
+        release();
+    }
+
+    /**
+     * Allocate a heap for the configuration, reusing the current one if it
+     * was allocated the same way
+     * @param config Engine configuration
+     * @param error Receives the failure reason
+     * @return true on success
+     */
+    bool acquire(const MicroPythonConfig& config, std::string& error);
+
+    /**
+     * Map a heap image from a file, private (copy-on-write) and at a fixed
+     * address. Clean pages stay shared with every other mapping of the file.
+     * @param fd Open image file
+     * @param offset Page-aligned offset of the heap image in the file
+     * @param address Address the heap must live at
+     * @param size Heap size in bytes
+     * @param error Receives the failure reason
+     * @return true on success
+     */
+    bool mapFile(int fd, uint64_t offset, void* address, size_t size, std::string& error);
+
+    /**
+     * Free the heap
+     */
+    void release();
+
+    char* data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    /**
+     * Check whether the heap starts on a page boundary (needed to snapshot it)
+     */
+    bool pageAligned() const;
+
+    /**
+     * Describe how the heap was actually allocated (after fallbacks)
+     * @return Short human-readable description
+     */
+    std::string describe() const;
+
+private:
+    bool matches(const MicroPythonConfig& config) const;
+    bool map(const MicroPythonConfig& config, std::string& error);
+    bool bindNode(int node, std::string& error);
+    void prefault();
+
+    char* data_ = nullptr;          // Heap start handed to the VM
+    size_t size_ = 0;               // Heap bytes handed to the VM
+    void* mapping_ = nullptr;       // Start of the mmap()ed region, if any
+    size_t mappingSize_ = 0;
+    HeapStrategy strategy_ = HeapStrategy::New;    // Requested strategy
+    bool hugeTlb_ = false;          // MAP_HUGETLB succeeded
+    bool prefaulted_ = false;
+    bool snapshot_ = false;         // Mapped from a snapshot image
+    int numaNode_ = -1;
+
+    HeapAllocation(const HeapAllocation&) = delete;
+    HeapAllocation& operator=(const HeapAllocation&) = delete;
+};
+
+#endif // HEAP_ALLOCATOR_H
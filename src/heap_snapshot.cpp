@@ -0,0 +1,191 @@
+#include "heap_snapshot.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define SNAPSHOT_HAVE_POSIX 1
+#else
+#define SNAPSHOT_HAVE_POSIX 0
+#endif
+
+namespace {
+
+constexpr char SNAPSHOT_MAGIC[8] = {'M', 'P', 'Y', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+// On-disk header; all fields are native endian, like the heap image
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t heap_address;
+    uint64_t heap_size;
+    uint64_t heap_offset;
+    uint64_t state_size;
+    char build_id[128];
+};
+
+#if SNAPSHOT_HAVE_POSIX
+uint64_t pageSize() {
+    long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? static_cast<uint64_t>(size) : 4096;
+}
+
+bool writeAll(int fd, const void* data, size_t len) {
+    const char* bytes = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t written = write(fd, bytes, len);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        len -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool readAll(int fd, void* data, size_t len) {
+    char* bytes = static_cast<char*>(data);
+    while (len > 0) {
+        ssize_t got = read(fd, bytes, len);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        bytes += got;
+        len -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+// Open a snapshot image and read everything but the heap (-1 on failure)
+int openSnapshot(const std::string& path, SnapshotImage& image, std::string& error) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "Cannot open snapshot file: " + path;
+        return -1;
+    }
+
+    SnapshotHeader header;
+    if (!readAll(fd, &header, sizeof(header)) ||
+        std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        error = "Invalid snapshot file: " + path;
+        close(fd);
+        return -1;
+    }
+    if (header.version != SNAPSHOT_VERSION || header.header_size != sizeof(header)) {
+        error = "Unsupported snapshot version: " + std::to_string(header.version);
+        close(fd);
+        return -1;
+    }
+    if (header.heap_offset % pageSize() != 0 ||
+        header.heap_offset < sizeof(header) + header.state_size) {
+        error = "Invalid snapshot file: " + path;
+        close(fd);
+        return -1;
+    }
+
+    header.build_id[sizeof(header.build_id) - 1] = '\0';
+    image.heap_address = static_cast<uintptr_t>(header.heap_address);
+    image.heap_size = static_cast<size_t>(header.heap_size);
+    image.heap_offset = header.heap_offset;
+    image.build_id = header.build_id;
+    image.state.resize(static_cast<size_t>(header.state_size));
+    if (!readAll(fd, image.state.data(), image.state.size())) {
+        error = "Truncated snapshot file: " + path;
+        close(fd);
+        return -1;
+    }
+
+    off_t fileSize = lseek(fd, 0, SEEK_END);
+    if (fileSize < 0 || static_cast<uint64_t>(fileSize) < image.heap_offset + image.heap_size) {
+        error = "Truncated snapshot file: " + path;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+#endif
+
+} // namespace
+
+// Write a snapshot image
+bool writeSnapshot(const std::string& path, SnapshotImage& image, const char* heap, std::string& error) {
+#if SNAPSHOT_HAVE_POSIX
+    uint64_t page = pageSize();
+    uint64_t stateEnd = sizeof(SnapshotHeader) + image.state.size();
+    image.heap_offset = (stateEnd + page - 1) / page * page;
+
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.header_size = sizeof(header);
+    header.heap_address = image.heap_address;
+    header.heap_size = image.heap_size;
+    header.heap_offset = image.heap_offset;
+    header.state_size = image.state.size();
+    std::strncpy(header.build_id, image.build_id.c_str(), sizeof(header.build_id) - 1);
+
+    std::string temp = path + ".tmp";
+    int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        error = "Cannot create snapshot file: " + path;
+        return false;
+    }
+    std::vector<char> padding(static_cast<size_t>(image.heap_offset - stateEnd), 0);
+    bool ok = writeAll(fd, &header, sizeof(header)) &&
+              writeAll(fd, image.state.data(), image.state.size()) &&
+              writeAll(fd, padding.data(), padding.size()) &&
+              writeAll(fd, heap, image.heap_size);
+    ok = close(fd) == 0 && ok;
+    if (!ok || std::rename(temp.c_str(), path.c_str()) != 0) {
+        error = std::string("Failed to write snapshot file: ") + std::strerror(errno);
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+#else
+    (void)path;
+    (void)image;
+    (void)heap;
+    error = "Snapshots are not supported on this platform";
+    return false;
+#endif
+}
+
+// Read a snapshot image and map its heap
+bool loadSnapshot(const std::string& path, const std::string& buildId,
+                  SnapshotImage& image, HeapAllocation& heap, std::string& error) {
+#if SNAPSHOT_HAVE_POSIX
+    int fd = openSnapshot(path, image, error);
+    if (fd < 0) {
+        return false;
+    }
+    if (image.build_id != buildId) {
+        error = "Snapshot was written by a different build: " + image.build_id;
+        close(fd);
+        return false;
+    }
+    // The mapping keeps its own reference to the file
+    bool mapped = heap.mapFile(fd, image.heap_offset, reinterpret_cast<void*>(image.heap_address),
+                               image.heap_size, error);
+    close(fd);
+    return mapped;
+#else
+    (void)path;
+    (void)buildId;
+    (void)image;
+    (void)heap;
+    error = "Snapshots are not supported on this platform";
+    return false;
+#endif
+}
@@ -0,0 +1,46 @@
+#ifndef HEAP_SNAPSHOT_H
+#define HEAP_SNAPSHOT_H
+
+#include "heap_allocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Snapshot image file
+ *
+ * Layout: a fixed header, the VM state blob, then the heap image starting
+ * at a page-aligned offset so it can be mapped straight from the file.
+ */
+struct SnapshotImage {
+    uintptr_t heap_address = 0;     // Address the heap was saved from
+    size_t heap_size = 0;
+    uint64_t heap_offset = 0;       // Page-aligned file offset of the heap image
+    std::string build_id;           // Build that wrote the image
+    std::vector<unsigned char> state;
+};
+
+/**
+ * Write a snapshot image (via a temporary file renamed into place)
+ * @param path Destination file
+ * @param image Header fields and state blob (heap_offset is filled in)
+ * @param heap Heap contents, image.heap_size bytes
+ * @param error Receives the failure reason
+ * @return true on success
+ */
+bool writeSnapshot(const std::string& path, SnapshotImage& image, const char* heap, std::string& error);
+
+/**
+ * Read a snapshot image and map its heap copy-on-write at the saved address
+ * @param path Image file
+ * @param buildId Build the image must have been written by
+ * @param image Receives header fields and state blob
+ * @param heap Receives the heap mapping
+ * @param error Receives the failure reason
+ * @return true on success
+ */
+bool loadSnapshot(const std::string& path, const std::string& buildId,
+                  SnapshotImage& image, HeapAllocation& heap, std::string& error);
+
+#endif // HEAP_SNAPSHOT_H
@@ -0,0 +1,179 @@
+#include "mapped_file.h"
+#include <cerrno>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_HAVE_MMAP 1
+#else
+#include <filesystem>
+#include <fstream>
+#define MAPPED_HAVE_MMAP 0
+#endif
+
+namespace {
+
+#if MAPPED_HAVE_MMAP
+FileStamp stampOf(const struct stat& st) {
+    FileStamp stamp;
+#ifdef __APPLE__
+    stamp.mtime = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    stamp.mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    stamp.size = static_cast<uint64_t>(st.st_size);
+    stamp.inode = static_cast<uint64_t>(st.st_ino);
+    stamp.device = static_cast<uint64_t>(st.st_dev);
+    return stamp;
+}
+#endif
+
+// Attempts to get a consistent copy of a file that keeps changing
+constexpr int COPY_ATTEMPTS = 3;
+
+} // namespace
+
+// Stat a file without opening it
+bool statFile(const std::string& path, FileStamp& stamp) {
+#if MAPPED_HAVE_MMAP
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    stamp = stampOf(st);
+    return true;
+#else
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    uintmax_t size = ec ? 0 : std::filesystem::file_size(path, ec);
+    if (ec) {
+        return false;
+    }
+    stamp = FileStamp();
+    stamp.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+    stamp.size = static_cast<uint64_t>(size);
+    return true;
+#endif
+}
+
+// Map a whole file read-only, or copy it
+bool MappedFile::open(const std::string& path, std::string& error, Mode mode) {
+    close();
+#if MAPPED_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "Cannot open file: " + path;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        error = "Not a regular file: " + path;
+        return false;
+    }
+    if (mode == Mode::Copy) {
+        bool copied = read(fd, path, error);
+        ::close(fd);
+        return copied;
+    }
+    stamp_ = stampOf(st);
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size > 0) {
+        int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        flags |= MAP_POPULATE;      // Scripts are read front to back right away
+#endif
+        void* mapping = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+        if (mapping == MAP_FAILED) {
+            error = "Cannot map file " + path + ": " + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        mapping_ = mapping;
+        data_ = static_cast<const char*>(mapping);
+        size_ = size;
+    }
+    ::close(fd);
+    return true;
+#else
+    (void)mode;
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open() || !statFile(path, stamp_)) {
+        error = "Cannot open file: " + path;
+        return false;
+    }
+    size_t size = static_cast<size_t>(file.tellg());
+    buffer_.reset(new char[size + 1]);
+    file.seekg(0);
+    if (!file.read(buffer_.get(), static_cast<std::streamsize>(size))) {
+        error = "Cannot read file: " + path;
+        buffer_.reset();
+        return false;
+    }
+    data_ = buffer_.get();
+    size_ = size;
+    return true;
+#endif
+}
+
+#if MAPPED_HAVE_MMAP
+// Copy the file; retried while a writer changes it under us so the stamp
+// always describes the copied bytes
+bool MappedFile::read(int fd, const std::string& path, std::string& error) {
+    for (int attempt = 0; attempt < COPY_ATTEMPTS; attempt++) {
+        struct stat before;
+        if (fstat(fd, &before) != 0) {
+            break;
+        }
+        size_t capacity = static_cast<size_t>(before.st_size);
+        buffer_.reset(new char[capacity + 1]);
+        size_t size = 0;
+        while (size < capacity) {
+            ssize_t count = pread(fd, buffer_.get() + size, capacity - size, static_cast<off_t>(size));
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count < 0) {
+                error = "Cannot read file " + path + ": " + std::strerror(errno);
+                buffer_.reset();
+                return false;
+            }
+            if (count == 0) {
+                break;      // Truncated meanwhile
+            }
+            size += static_cast<size_t>(count);
+        }
+        struct stat after;
+        if (fstat(fd, &after) != 0) {
+            break;
+        }
+        stamp_ = stampOf(after);
+        if (stampOf(before) == stamp_ && size == capacity) {
+            data_ = buffer_.get();
+            size_ = size;
+            return true;
+        }
+    }
+    buffer_.reset();
+    stamp_ = FileStamp();
+    error = "File keeps changing while being read: " + path;
+    return false;
+}
+#endif
+
+// Unmap the file
+void MappedFile::close() {
+#if MAPPED_HAVE_MMAP
+    if (mapping_) {
+        munmap(mapping_, size_);
+    }
+#endif
+    mapping_ = nullptr;
+    buffer_.reset();
+    data_ = "";
+    size_ = 0;
+    stamp_ = FileStamp();
+}
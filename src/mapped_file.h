@@ -0,0 +1,100 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * Identity of a file's contents as seen by stat(): a cached compilation
+ * is reused only while all fields still match
+ */
+struct FileStamp {
+    int64_t mtime = 0;      // Modification time in nanoseconds
+    uint64_t size = 0;
+    uint64_t inode = 0;     // Changes when the file is replaced by rename()
+    uint64_t device = 0;
+
+    bool operator==(const FileStamp& other) const {
+        return mtime == other.mtime && size == other.size &&
+               inode == other.inode && device == other.device;
+    }
+    bool operator!=(const FileStamp& other) const {
+        return !(*this == other);
+    }
+};
+
+/**
+ * Stat a file without opening it
+ * @param path File path
+ * @param stamp Receives the file's stamp
+ * @return false if the file does not exist or cannot be accessed
+ */
+bool statFile(const std::string& path, FileStamp& stamp);
+
+/**
+ * Read-only view of a whole file
+ *
+ * The file is mapped with mmap() so its contents reach the compiler
+ * without being copied; platforms without mmap() read it into a buffer.
+ * A mapped file must not be truncated or rewritten in place while the
+ * view is used (touching the lost pages raises SIGBUS), so files that
+ * may be edited meanwhile are opened with Mode::Copy.
+ */
+class MappedFile {
+public:
+    enum class Mode {
+        Map,        // mmap() the file
+        Copy        // read() it into a buffer, safe against concurrent writers
+    };
+
+    MappedFile() = default;
+    ~MappedFile() {
+        close();
+    }
+
+    /**
+     * Map or read a file
+     * @param path File path
+     * @param error Receives the failure reason
+     * @param mode Map the file or copy its contents
+     * @return true on success
+     */
+    bool open(const std::string& path, std::string& error, Mode mode = Mode::Map);
+
+    /**
+     * Unmap the file
+     */
+    void close();
+
+    const char* data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    /**
+     * Stamp of the mapped contents (taken from the open file, so it
+     * matches what data() holds even if the path changed since)
+     */
+    const FileStamp& stamp() const {
+        return stamp_;
+    }
+
+private:
+    bool read(int fd, const std::string& path, std::string& error);
+
+    const char* data_ = "";
+    size_t size_ = 0;
+    void* mapping_ = nullptr;           // mmap()ed region, if any
+    std::unique_ptr<char[]> buffer_;    // Contents without mmap()
+    FileStamp stamp_;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
+
+#endif // MAPPED_FILE_H
@@ -10,14 +10,240 @@
 
 #include <stddef.h>
 
+#include "micropython_objrepr.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Result codes of the exec functions
+#define MP_EMBED_OK             (0)
+#define MP_EMBED_ERROR          (-1)    // Uncaught exception or compile error
+#define MP_EMBED_INTERRUPTED    (-2)    // Stopped by mp_embed_interrupt()
+
+// Per-engine VM context holding a complete interpreter state (the
+// mp_state_ctx, GC heap, qstr pools and stack limits). All other calls act
+// on the context that is current on the calling thread, so independent
+// contexts can run on different threads in parallel.
+typedef struct _mp_embed_ctx_t mp_embed_ctx_t;
+
+// Opaque handle to a compiled module function. A real port keeps the
+// underlying raw code reachable from the GC roots until it is freed.
+typedef struct _mp_embed_compiled_t mp_embed_compiled_t;
+
+// VM context management
+mp_embed_ctx_t *mp_embed_ctx_new(size_t stack_limit);
+void mp_embed_ctx_free(mp_embed_ctx_t *ctx);
+// Make ctx current on this thread; stack_top is the caller's frame address
+// used for stack-limit checks. Returns the previously current context.
+mp_embed_ctx_t *mp_embed_ctx_enter(mp_embed_ctx_t *ctx, void *stack_top);
+void mp_embed_ctx_leave(mp_embed_ctx_t *previous);
+// Route the output of ctx: print_fn receives script output (print(),
+// tracebacks; mp_hal_stdout_tx_strn() in a real port), trace_fn
+// diagnostics of the embed layer. NULL discards. Kept for the lifetime of
+// ctx, across init, reset and deinit.
+typedef void (*mp_embed_write_fn_t)(void *data, const char *str, size_t len);
+void mp_embed_ctx_set_output(mp_embed_ctx_t *ctx, mp_embed_write_fn_t print_fn, mp_embed_write_fn_t trace_fn, void *data);
+
+// Ask the code running in ctx to stop with KeyboardInterrupt. Safe to call
+// from any thread; a real port uses mp_sched_keyboard_interrupt().
+void mp_embed_interrupt(mp_embed_ctx_t *ctx);
+// Discard an interrupt of the current context that was not delivered
+void mp_embed_clear_interrupt(void);
+
+// Sampling profiler hook. mp_embed_profile_request() asks the code running
+// in ctx to report its Python call stack once, at the next point where the
+// VM polls for pending events (the KeyboardInterrupt/mp_sched check on
+// calls and backward jumps), so the VM does no extra work while no
+// request is pending. Safe to call from any thread. A real port walks
+// MP_STATE_THREAD(current_code_state) through prev_state and gets each
+// line from the bytecode's line-number table. sample_fn receives the
+// frames innermost first on the thread running the code; the strings are
+// only valid during the call, and it must not block or call into the VM.
+typedef struct _mp_embed_frame_t {
+    const char *function;       // "<module>" for module-level code
+    const char *source;         // Source file name
+    unsigned int line;
+} mp_embed_frame_t;
+typedef void (*mp_embed_sample_fn_t)(void *data, const mp_embed_frame_t *frames, size_t depth);
+void mp_embed_ctx_set_profiler(mp_embed_ctx_t *ctx, mp_embed_sample_fn_t sample_fn, void *data);
+void mp_embed_profile_request(mp_embed_ctx_t *ctx);
+
 // MicroPython embed API stub functions
 int mp_embed_init(void *heap, size_t heap_size, void *stack_top);
 void mp_embed_deinit(void);
 int mp_embed_exec_str(const char *code);
+// Soft reset of the current context, like MicroPython's soft reboot: runs
+// finalisers, re-runs gc_init() on the same heap and mp_init(), dropping
+// globals and sys.modules. The heap memory and the context's static
+// structures are kept. Compiled handles of the context must be freed first.
+int mp_embed_reset(void);
+
+// Heap statistics of the current context: gc_info() plus the collection
+// counters the port's gc_collect() keeps. Sizes are in bytes.
+typedef struct _mp_embed_heap_info_t {
+    size_t total;
+    size_t used;
+    size_t free;
+    size_t max_free;            // Largest contiguous free run
+    size_t block_size;          // MICROPY_BYTES_PER_GC_BLOCK
+    size_t num_1block;          // Live allocations of one block
+    size_t num_2block;          // Live allocations of two blocks
+    size_t max_block;           // Largest live allocation
+    size_t alloc_since_gc;      // Bytes allocated since the last collection
+    unsigned long long allocations;     // Heap allocations made so far
+    unsigned long long collections;
+    unsigned long long gc_time_us;  // Cumulative time spent collecting
+    size_t exec_used;           // Executable memory held by native code
+    size_t exec_total;          // Executable memory mapped by the context
+} mp_embed_heap_info_t;
+
+void mp_embed_heap_info(mp_embed_heap_info_t *info);
+
+// Garbage collection control for the current context
+void mp_embed_gc_collect(void);
+// gc.enable()/gc.disable(): with auto-collect off a full heap raises
+// MemoryError instead of collecting. Returns the previous setting.
+int mp_embed_gc_set_auto(int enabled);
+// gc.threshold(): collect after this many bytes were allocated (0 = only
+// when the heap is full)
+void mp_embed_gc_set_threshold(size_t bytes);
+
+// Per-job allocation quota of the current context, enforced in the GC
+// allocator (gc_alloc() in a real port): an allocation that would exceed
+// a limit fails and the script gets MemoryError. 0 disables a limit.
+#define MP_EMBED_QUOTA_NONE     (0)
+#define MP_EMBED_QUOTA_ALLOC    (1)     // Bytes allocated by the job
+#define MP_EMBED_QUOTA_LIVE     (2)     // Growth of live heap bytes during the job
+typedef struct _mp_embed_quota_usage_t {
+    size_t allocated;           // Bytes allocated since mp_embed_quota_begin()
+    size_t peak_live;           // Peak growth of live heap bytes since then
+    int exceeded;               // MP_EMBED_QUOTA_* limit hit first
+} mp_embed_quota_usage_t;
+void mp_embed_quota_begin(size_t max_alloc, size_t max_live);
+void mp_embed_quota_usage(mp_embed_quota_usage_t *usage);
+void mp_embed_quota_end(void);
+
+// Host memory exposed to Python: a memoryview object whose items point at
+// the host memory instead of the GC heap, bound to a global name. Release
+// detaches it (its length becomes 0) so stale references can no longer
+// reach the memory. Buffers must be released before reset or deinit.
+typedef struct _mp_embed_buffer_t mp_embed_buffer_t;
+#define MP_EMBED_BUFFER_READONLY    (0)
+#define MP_EMBED_BUFFER_WRITABLE    (1)
+mp_embed_buffer_t *mp_embed_buffer_new(const char *name, void *data, size_t len, char typecode, int flags);
+void mp_embed_buffer_release(mp_embed_buffer_t *buffer);
+
+// Objects. All calls act on the current context. Like any MicroPython
+// object, one created here stays alive only while it is reachable from a
+// GC root: the C stack, a registered root array or a pinned object. On
+// MemoryError the constructors return MP_EMBED_OBJ_NULL.
+#define MP_EMBED_TYPE_NONE      (0)
+#define MP_EMBED_TYPE_BOOL      (1)
+#define MP_EMBED_TYPE_INT       (2)
+#define MP_EMBED_TYPE_FLOAT     (3)
+#define MP_EMBED_TYPE_STR       (4)
+#define MP_EMBED_TYPE_TUPLE     (5)
+#define MP_EMBED_TYPE_LIST      (6)
+#define MP_EMBED_TYPE_CALLABLE  (7)
+#define MP_EMBED_TYPE_OTHER     (8)
+
+mp_embed_obj_t mp_embed_obj_new_int(long long value);
+mp_embed_obj_t mp_embed_obj_new_float(double value);
+mp_embed_obj_t mp_embed_obj_new_str(const char *data, size_t len);
+// Sequences start out filled with None
+mp_embed_obj_t mp_embed_obj_new_tuple(size_t len);
+mp_embed_obj_t mp_embed_obj_new_list(size_t len);
+void mp_embed_obj_set_item(mp_embed_obj_t seq, size_t index, mp_embed_obj_t item);
+
+int mp_embed_obj_get_type(mp_embed_obj_t obj);
+// Conversions return MP_EMBED_OK, or MP_EMBED_ERROR on a type mismatch
+int mp_embed_obj_get_int(mp_embed_obj_t obj, long long *value);
+int mp_embed_obj_get_float(mp_embed_obj_t obj, double *value);  // int or float
+int mp_embed_obj_get_str(mp_embed_obj_t obj, const char **data, size_t *len);
+int mp_embed_obj_get_len(mp_embed_obj_t obj, size_t *len);
+mp_embed_obj_t mp_embed_obj_get_item(mp_embed_obj_t seq, size_t index);
+
+// Register an array of GC roots owned by the embedder (e.g. its argument
+// slots); it must stay valid until replaced. Cleared by a soft reset.
+void mp_embed_set_roots(mp_embed_obj_t *roots, size_t count);
+// Keep an object alive regardless of reachability (counted)
+void mp_embed_obj_pin(mp_embed_obj_t obj);
+void mp_embed_obj_unpin(mp_embed_obj_t obj);
+
+// Resolve "name" in __main__ (falling back to builtins) or "module.name",
+// importing the module if needed. The result is pinned; MP_EMBED_OBJ_NULL
+// if it cannot be resolved (see mp_embed_error_message()).
+mp_embed_obj_t mp_embed_lookup(const char *name, size_t len);
+// Call fun(*args); returns an MP_EMBED_* result code
+int mp_embed_call(mp_embed_obj_t fun, size_t n_args, const mp_embed_obj_t *args, mp_embed_obj_t *result);
+// "ExceptionType: message" of the last failed call in the current context
+const char *mp_embed_error_message(void);
+
+// Native functions. fn receives the data pointer it was registered with and
+// returns MP_EMBED_OK with *result set, or the result of mp_embed_raise().
+typedef int (*mp_embed_native_fn_t)(void *data, size_t n_args, const mp_embed_obj_t *args, mp_embed_obj_t *result);
+typedef struct _mp_embed_native_fun_t {
+    const char *name;
+    mp_embed_native_fn_t fn;
+    void *data;
+} mp_embed_native_fun_t;
+// Register (or replace) a module of native functions in the current
+// context. Like the port's built-in modules, the function objects live
+// outside the GC heap, so importing it is a table lookup. The table and
+// names are copied. Dropped by mp_embed_reset() and mp_embed_deinit().
+int mp_embed_register_module(const char *name, const mp_embed_native_fun_t *funs, size_t n_funs);
+// Raise an exception from a native function; returns MP_EMBED_ERROR
+int mp_embed_raise(const char *type, const char *message);
+
+// Heap snapshots. The interpreter state outside the heap (mp_state_ctx
+// without thread-specific fields) plus a byte copy of the heap fully
+// describe a warmed-up VM. The heap holds absolute pointers into itself
+// and into the binary, so an image can only be restored at the address it
+// was saved from and by the build reported by mp_embed_build_id().
+const char *mp_embed_build_id(void);
+size_t mp_embed_snapshot_state_size(void);
+// Copy the current context's state into state (len bytes)
+int mp_embed_snapshot_save(void *state, size_t len);
+// Adopt a saved state instead of calling mp_embed_init(); heap must already
+// hold the saved image at its original address
+int mp_embed_snapshot_restore(void *heap, size_t heap_size, const void *state, size_t len, void *stack_top);
+
+// Compiled code API (lex/parse/compile once, execute many times). A
+// compiled handle belongs to the context it was created in and may only
+// be executed there; it can be freed from any thread.
+mp_embed_compiled_t *mp_embed_compile_str(const char *code, size_t len, const char *source_name);
+int mp_embed_exec_compiled(mp_embed_compiled_t *compiled);
+void mp_embed_free_compiled(mp_embed_compiled_t *compiled);
+// Run compiled code as the body of a new module object and, only if it
+// completes, bind it to sys.modules[name] in place of the previous
+// module. A failing body leaves the previous module untouched, so an
+// import never observes a half-initialized module.
+int mp_embed_module_load(const char *name, mp_embed_compiled_t *compiled);
+
+// Code emitters. The native ones exist when built with MICROPY_EMIT_X64
+// (MICROPYTHON_NATIVE_EMITTER in CMake); @micropython.native and
+// @micropython.viper select them per function regardless of the default.
+#define MP_EMBED_EMIT_BYTECODE  (0)
+#define MP_EMBED_EMIT_NATIVE    (1)
+#define MP_EMBED_EMIT_VIPER     (2)
+// Emitter for code compiled in the current context without a decorator
+// (default_emit_opt); MP_EMBED_ERROR if it was not built in
+int mp_embed_set_emitter(int emitter);
+// Executable memory for native code (the port's MP_PLAT_ALLOC_EXEC,
+// MP_PLAT_COMMIT_EXEC and MP_PLAT_FREE_EXEC). The GC heap is never
+// executable, so each context keeps a code arena next to it. Allocated
+// code is writable until committed, then read/execute only; commit returns
+// NULL if the pages cannot be made executable. The arena goes away with
+// mp_embed_reset() and mp_embed_deinit(), like the function objects
+// pointing into it, and is not part of a heap snapshot.
+void mp_embed_alloc_exec(size_t min_size, void **ptr, size_t *size);
+void *mp_embed_commit_exec(void *ptr, size_t size, void *reloc);
+void mp_embed_free_exec(void *ptr, size_t size);
+
+// Load precompiled .mpy bytecode; works without MICROPY_ENABLE_COMPILER.
+// The data is copied into the runtime and need not outlive the call.
+mp_embed_compiled_t *mp_embed_load_mpy(const unsigned char *data, size_t len, const char *source_name);
 
 #ifdef __cplusplus
 }
@@ -1,7 +1,23 @@
 #include "micropython_engine.h"
 #include <iostream>
-#include <fstream>
 #include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <array>
+#include <map>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "compiled_code_cache.h"
+#include "heap_allocator.h"
+#include "heap_snapshot.h"
+#include "mapped_file.h"
+#include "module_watcher.h"
+#include "mpsc_queue.h"
+#include "sampling_profiler.h"
+#include "watchdog.h"
 
 #if USE_REAL_MICROPYTHON
 extern "C" {
@@ -11,6 +27,55 @@ extern "C" {
 }
 #endif
 
+#if USE_REAL_MICROPYTHON
+// Compiled module function owned by the embed layer
+using CompiledCode = std::shared_ptr<mp_embed_compiled_t>;
+#else
+// The stub backend has no compiler; the "compiled" form is the source
+// text, or just the size of a precompiled .mpy image
+struct StubCode {
+    std::string source;
+    size_t mpy_size = 0;
+};
+using CompiledCode = std::shared_ptr<const StubCode>;
+#endif
+
+#ifndef MICROPY_ENABLE_COMPILER
+#define MICROPY_ENABLE_COMPILER 1
+#endif
+
+#if MICROPYTHON_FROZEN_MODULES
+// Frozen module names: NUL-separated, terminated by an empty name
+extern "C" const char mp_frozen_names[];
+#endif
+
+// .mpy header: 'M', format version, feature flags, small int bits
+static constexpr unsigned char MPY_VERSION = 6;
+static constexpr size_t MPY_HEADER_SIZE = 4;
+
+/**
+ * Shared state of an executeAsync() job
+ */
+struct AsyncJobState {
+    enum class Status { Queued, Running, Done };
+    
+    std::mutex mutex;               // Guards status and cancelled
+    Status status = Status::Queued;
+    bool cancelled = false;
+    MicroPythonEngine* engine = nullptr;
+};
+
+/**
+ * Shared state of an exposeBuffer() handle
+ */
+struct BufferState {
+    MicroPythonEngine* engine = nullptr;    // nullptr once detached
+    std::string name;
+#if USE_REAL_MICROPYTHON
+    mp_embed_buffer_t* buffer = nullptr;
+#endif
+};
+
 /**
  * Private implementation class using PIMPL idiom
  */
@@ -19,198 +84,1793 @@ public:
     bool initialized = false;
     MicroPythonConfig config;
     std::string lastError;
-    char* heap_memory = nullptr;
+    ErrorCode lastErrorCode = ErrorCode::None;  // Meaningful while lastError is set
+    HeapAllocation heap;            // Survives shutdown() for reuse
+    CompiledCodeCache<CompiledCode> codeCache;
+    
+    // Serializes VM entry between callers and the executor thread
+    std::recursive_mutex vmMutex;
+    
+#if USE_REAL_MICROPYTHON
+    mp_embed_ctx_t* ctx = nullptr;  // This engine's own VM state
+#else
+    std::atomic<bool> stubInterrupt{false};
+    uint64_t stubCollections = 0;
+    std::chrono::microseconds stubGcTime{0};
+#endif
+    
+    // Typed calls: resolved functions (pinned in the VM) and argument slots
+    // registered as GC roots; nested calls use the slots as a stack
+    static constexpr size_t CALL_SLOTS = 4 * (MaxCallArgs + 1);
+    std::map<std::string, mp_embed_obj_t, std::less<>> functionCache;
+    std::array<mp_embed_obj_t, CALL_SLOTS> callSlots{};
+    size_t callSlotsUsed = 0;
+    
+    // Host buffers currently exposed to Python
+    std::vector<std::shared_ptr<BufferState>> buffers;
+    
+    // Script output goes to config.output, else to this ring; a job run
+    // with executeString(code, output) is captured instead
+    RingBufferSink outputRing;
+    std::string* capture = nullptr;
+    
+    // Native modules; installed into the VM after every init and reset
+    std::vector<std::unique_ptr<NativeModule>> modules;
+    
+    // Garbage collection policy
+    bool autoCollect = true;
+    double gcPauseEstimateUs = 0;   // Moving average of measured pauses
+    bool gcPauseKnown = false;
+    
+    // Asynchronous execution: lock-free submission, one executor thread
+    struct AsyncTask : MpscNode {
+        std::string code;
+        AsyncCallback callback;
+        std::promise<ExecutionResult> promise;
+        std::shared_ptr<AsyncJobState> state;
+    };
+    MpscQueue<AsyncTask> asyncQueue;
+    std::atomic<size_t> asyncPending{0};
+    std::thread executor;
+    std::mutex executorMutex;               // Guards executor start/stop and sleeping
+    std::condition_variable executorCv;
+    std::atomic<bool> executorRunning{false};
+    std::atomic<bool> executorSleeping{false};
+    std::atomic<bool> executorStop{false};
+    AsyncJobState* runningJob = nullptr;    // Job the executor is on; guarded by executorMutex
+    
+    // Execution time limit: the shared watchdog interrupts the outermost
+    // execution once max_execution_time has passed
+    WatchdogTimer deadline;
+    std::atomic<bool> timedOut{false};
+    int executionDepth = 0;
+    
+    // Memory quota of the outermost execution, enforced by the allocator
+    JobUsage lastJobUsage;
+    
+    // Hot reload: the watcher thread swaps changed modules into sys.modules
+    // while holding the engine lock, i.e. between jobs
+    ModuleWatcher watcher;
+    std::map<std::string, FileStamp> moduleStamps;  // Contents of the loaded modules
+    ReloadStats reloadStats;
+    
+    // Sampling profiler: while profiling is on the VM records call stacks
+    // into the session. Toggled and read under profileMutex instead of the
+    // engine lock, so a running job can be profiled.
+    ProfileSession profile;
+    std::atomic<bool> profiling{false};
+    std::mutex profileMutex;
+    
+    Impl() {
+        deadline.fire = &Impl::onTimeout;
+        deadline.data = this;
+    }
+    ~Impl() {
+        stopExecutor();
+        watcher.stop();
+        stopProfiling();
+        cleanup();
+#if USE_REAL_MICROPYTHON
+        mp_embed_ctx_free(ctx);
+#endif
+    }
+    
+    void cleanup() {
+        // Compiled code lives on the Python heap; the heap itself is kept
+        // for the next initialize() and freed with the engine
+        codeCache.clear();
+    }
+    
+    // Compile Python source into a reusable code object
+    CompiledCode compile(std::string_view code, const char* sourceName) {
+#if !MICROPY_ENABLE_COMPILER
+        (void)code;
+        (void)sourceName;
+        setError(ErrorCode::Unsupported, "Compiler disabled in this build; use executeCompiled()");
+        return nullptr;
+#elif USE_REAL_MICROPYTHON
+        mp_embed_compiled_t* compiled = mp_embed_compile_str(code.data(), code.size(), sourceName);
+        if (!compiled) {
+            setError(ErrorCode::CompileError, "MicroPython compilation failed");
+            return nullptr;
+        }
+        return CompiledCode(compiled, mp_embed_free_compiled);
+#else
+        (void)sourceName;
+        return std::make_shared<const StubCode>(StubCode{std::string(code)});
+#endif
+    }
+    
+    // Load precompiled .mpy bytecode into a code object
+    CompiledCode load(const void* data, size_t len, const char* sourceName) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        if (!bytes || len < MPY_HEADER_SIZE || bytes[0] != 'M') {
+            setError(ErrorCode::CompileError, "Invalid .mpy data: bad header");
+            return nullptr;
+        }
+        if (bytes[1] != MPY_VERSION) {
+            setError(ErrorCode::CompileError, "Incompatible .mpy version: " + std::to_string(bytes[1]) +
+                     " (expected " + std::to_string(MPY_VERSION) + ")");
+            return nullptr;
+        }
+#if USE_REAL_MICROPYTHON
+        mp_embed_compiled_t* compiled = mp_embed_load_mpy(bytes, len, sourceName);
+        if (!compiled) {
+            setError(ErrorCode::CompileError, "Failed to load .mpy data");
+            return nullptr;
+        }
+        return CompiledCode(compiled, mp_embed_free_compiled);
+#else
+        return std::make_shared<const StubCode>(StubCode{sourceName, len});
+#endif
+    }
+    
+    // Run previously compiled code
+    bool run(const CompiledCode& compiled) {
+        clearFunctionCache();
+        JobScope job(*this);
+#if USE_REAL_MICROPYTHON
+        int result = mp_embed_exec_compiled(compiled.get());
+        if (result == MP_EMBED_OK) {
+            lastError.clear();
+            return true;
+        } else if (result == MP_EMBED_INTERRUPTED) {
+            setInterrupted();
+            return false;
+        } else {
+            if (!quotaExceeded()) {
+                setError(ErrorCode::PythonException, "MicroPython execution failed with code: " + std::to_string(result));
+            }
+            return false;
+        }
+#else
+        if (compiled->mpy_size) {
+            log(LogLevel::Debug, [&](std::ostream& out) {
+                out << "Executing precompiled module " << compiled->source
+                    << " (" << compiled->mpy_size << " bytes)";
+            });
+        } else if (!simulateExecution(compiled->source)) {
+            setInterrupted();
+            return false;
+        }
+        lastError.clear();
+        return true;
+#endif
+    }
+    
+    // Execute source, reusing compiled code from the cache when possible
+    bool executeSource(std::string_view code, const char* sourceName) {
+        CompiledCode compiled = codeCache.findSource(code, sourceName);
+        if (!compiled) {
+            compiled = compile(code, sourceName);
+            if (!compiled) {
+                return false;
+            }
+            codeCache.insertSource(code, sourceName, compiled);
+        }
+        return run(compiled);
+    }
+    
+    // Ask the running code to stop; safe to call from any thread
+    void interrupt() {
+#if USE_REAL_MICROPYTHON
+        if (ctx) {
+            mp_embed_interrupt(ctx);
+        }
+#else
+        stubInterrupt.store(true);
+#endif
+    }
+    
+    // Drop an interrupt that arrived after the code it targeted finished
+    void clearInterrupt() {
+#if USE_REAL_MICROPYTHON
+        mp_embed_clear_interrupt();
+#else
+        stubInterrupt.store(false);
+#endif
+    }
+    
+#if USE_REAL_MICROPYTHON
+    // Each engine gets its own VM context so engines never share state
+    bool ensureContext() {
+        if (!ctx) {
+            ctx = mp_embed_ctx_new(config.stack_limit);
+            if (!ctx) {
+                setError(ErrorCode::ResourceError, "Failed to allocate VM context");
+                return false;
+            }
+            mp_embed_ctx_set_output(ctx, &Impl::printCallback, &Impl::traceCallback, this);
+            mp_embed_ctx_set_profiler(ctx, &Impl::sampleCallback, this);
+        }
+        return true;
+    }
+#endif
+    
+    // Record a failure
+    void setError(ErrorCode code, std::string message) {
+        lastErrorCode = code;
+        lastError = std::move(message);
+    }
+    
+    // Record an interrupted execution, telling timeouts apart
+    void setInterrupted() {
+        if (timedOut.load()) {
+            setError(ErrorCode::Timeout, "Execution timed out after " +
+                     std::to_string(config.max_execution_time.count()) + " ms");
+        } else {
+            setError(ErrorCode::Interrupted, "Execution interrupted");
+        }
+    }
+    
+    static void onTimeout(void* data) {
+        Impl* impl = static_cast<Impl*>(data);
+        impl->timedOut.store(true);
+        impl->interrupt();
+    }
+    
+    bool hasQuota() const {
+        return config.job_alloc_quota > 0 || config.job_live_quota > 0;
+    }
+    
+    // Record QuotaExceeded if the running job's MemoryError came from its quota
+    bool quotaExceeded() {
+#if USE_REAL_MICROPYTHON
+        if (executionDepth == 0 || !hasQuota()) {
+            return false;
+        }
+        mp_embed_quota_usage_t usage;
+        mp_embed_quota_usage(&usage);
+        if (usage.exceeded == MP_EMBED_QUOTA_ALLOC) {
+            setError(ErrorCode::QuotaExceeded, "MemoryError: job allocation quota exceeded (" +
+                     std::to_string(usage.allocated) + " bytes allocated, limit " +
+                     std::to_string(config.job_alloc_quota) + ")");
+            return true;
+        } else if (usage.exceeded == MP_EMBED_QUOTA_LIVE) {
+            setError(ErrorCode::QuotaExceeded, "MemoryError: job live heap quota exceeded (peak " +
+                     std::to_string(usage.peak_live) + " bytes, limit " +
+                     std::to_string(config.job_live_quota) + ")");
+            return true;
+        }
+#endif
+        return false;
+    }
+    
+    /**
+     * Bounds one job by max_execution_time and the memory quota; nested
+     * executions (from native callbacks) count towards the outermost job
+     */
+    class JobScope {
+    public:
+        explicit JobScope(Impl& impl)
+            : impl(impl),
+              outermost(impl.executionDepth++ == 0),
+              armed(outermost && impl.config.max_execution_time.count() > 0),
+              metered(outermost && impl.hasQuota()) {
+            if (armed) {
+                impl.timedOut.store(false);
+                Watchdog::instance().arm(impl.deadline, impl.config.max_execution_time);
+            }
+            if (outermost) {
+                impl.profile.setRunning(true);
+            }
+#if USE_REAL_MICROPYTHON
+            if (metered) {
+                mp_embed_quota_begin(impl.config.job_alloc_quota, impl.config.job_live_quota);
+            }
+#endif
+        }
+        ~JobScope() {
+            impl.executionDepth--;
+            if (armed) {
+                Watchdog::instance().disarm(impl.deadline);
+                if (impl.timedOut.load()) {
+                    // The code may have finished before noticing
+                    impl.clearInterrupt();
+                }
+            }
+            if (outermost) {
+                impl.profile.setRunning(false);
+            }
+#if USE_REAL_MICROPYTHON
+            if (metered) {
+                mp_embed_quota_usage_t usage;
+                mp_embed_quota_usage(&usage);
+                mp_embed_quota_end();
+                impl.lastJobUsage.allocated = usage.allocated;
+                impl.lastJobUsage.peak_live = usage.peak_live;
+                if (usage.exceeded != MP_EMBED_QUOTA_NONE) {
+                    // Free what the failed job left behind so the next
+                    // job starts from a clean heap without a reset
+                    impl.collect();
+                }
+            }
+#endif
+        }
+    
+    private:
+        Impl& impl;
+        bool outermost;
+        bool armed;
+        bool metered;
+        
+        JobScope(const JobScope&) = delete;
+        JobScope& operator=(const JobScope&) = delete;
+    };
+    
+    // Deliver script output
+    void write(const char* data, size_t len) {
+        if (capture) {
+            capture->append(data, len);
+        } else if (config.output) {
+            config.output->write(data, len);
+        } else {
+            outputRing.write(data, len);
+        }
+    }
+    
+    // Emit a diagnostic; format is only run if the level is enabled
+    template <typename Format>
+    void log(LogLevel level, Format format) {
+        if (level == LogLevel::Off || level > config.log_level) {
+            return;
+        }
+        std::ostringstream message;
+        format(message);
+        if (config.log_handler) {
+            config.log_handler(level, message.str());
+        } else {
+            std::cerr << message.str() << std::endl;
+        }
+    }
+    
+#if USE_REAL_MICROPYTHON
+    static void printCallback(void* data, const char* str, size_t len) {
+        static_cast<Impl*>(data)->write(str, len);
+    }
+    
+    static void traceCallback(void* data, const char* str, size_t len) {
+        while (len > 0 && str[len - 1] == '\n') {
+            len--;
+        }
+        static_cast<Impl*>(data)->log(LogLevel::Debug, [&](std::ostream& out) {
+            out.write(str, len);
+        });
+    }
+    
+    // Record a sampled call stack as one folded line, outermost frame first
+    static void sampleCallback(void* data, const mp_embed_frame_t* frames, size_t depth) {
+        Impl* impl = static_cast<Impl*>(data);
+        if (!impl->profiling.load(std::memory_order_relaxed)) {
+            return;
+        }
+        char line[1024];
+        size_t len = 0;
+        for (size_t i = depth; i-- > 0;) {
+            size_t room = sizeof(line) - len - 1;   // Keep room for the newline
+            int written = std::snprintf(line + len, room, "%s%s (%s:%u)", len ? ";" : "",
+                                        frames[i].function, frames[i].source, frames[i].line);
+            if (written < 0 || static_cast<size_t>(written) >= room) {
+                break;      // Too deep: keep the outer frames
+            }
+            // Separators must not appear inside a frame
+            for (size_t j = len ? len + 1 : 0; j < len + written; j++) {
+                if (line[j] == ';' || line[j] == '\n') {
+                    line[j] = '_';
+                }
+            }
+            len += written;
+        }
+        line[len++] = '\n';
+        impl->profile.record(line, len);
+    }
+    
+    static void onSampleRequest(void* data) {
+        mp_embed_profile_request(static_cast<Impl*>(data)->ctx);
+    }
+#endif
+    
+    void stopProfiling() {
+        std::lock_guard<std::mutex> lock(profileMutex);
+        if (profiling.exchange(false)) {
+            SamplingProfiler::instance().remove(profile);
+        }
+    }
+    
+    // Identifies the build a snapshot image must come from
+    static std::string buildId() {
+#if USE_REAL_MICROPYTHON
+        return mp_embed_build_id();
+#else
+        return "stub";
+#endif
+    }
+    
+    // Make the call slots visible to the GC (after init and soft reset)
+    void registerRoots() {
+        callSlots.fill(MP_EMBED_OBJ_NONE);
+        callSlotsUsed = 0;
+#if USE_REAL_MICROPYTHON
+        mp_embed_set_roots(callSlots.data(), callSlots.size());
+#endif
+    }
+    
+    // Register a native module with the VM (replacing an earlier version)
+    void installModule(const NativeModule& module) {
+#if USE_REAL_MICROPYTHON
+        // Cached lookups may point into the table being replaced
+        clearFunctionCache();
+        std::vector<mp_embed_native_fun_t> table;
+        table.reserve(module.functions().size());
+        for (const auto& function : module.functions()) {
+            table.push_back({function.name.c_str(), function.trampoline, function.target.get()});
+        }
+        mp_embed_register_module(module.name().c_str(), table.data(), table.size());
+#else
+        (void)module;
+#endif
+    }
+    
+    void installModules() {
+        for (const auto& module : modules) {
+            installModule(*module);
+        }
+    }
+    
+    // Run a module file and bind it in sys.modules (engine lock held)
+    bool loadModule(const std::string& name, const std::string& path, const MappedFile& file) {
+#if USE_REAL_MICROPYTHON
+        mp_embed_compiled_t* compiled = mp_embed_compile_str(file.data(), file.size(), path.c_str());
+        if (!compiled) {
+            setError(ErrorCode::CompileError, "Failed to compile module " + path);
+            return false;
+        }
+        int result;
+        {
+            JobScope job(*this);
+            result = mp_embed_module_load(name.c_str(), compiled);
+        }
+        mp_embed_free_compiled(compiled);
+        if (result == MP_EMBED_INTERRUPTED) {
+            setInterrupted();
+            return false;
+        } else if (result != MP_EMBED_OK) {
+            setError(ErrorCode::PythonException, name + ": " + mp_embed_error_message());
+            return false;
+        }
+        // Cached lookups may resolve into the replaced module
+        clearFunctionCache();
+#else
+        log(LogLevel::Debug, [&](std::ostream& out) {
+            out << "Loading module " << name << " from " << path << " (" << file.size() << " bytes)";
+        });
+#endif
+        moduleStamps[name] = file.stamp();
+        return true;
+    }
+    
+    // Load every module of the watched directory (engine lock held)
+    void loadWatchedModules() {
+        moduleStamps.clear();
+        for (const auto& module : watcher.modules()) {
+            MappedFile file;
+            std::string error;
+            if (!file.open(module.second, error, MappedFile::Mode::Copy) || !loadModule(module.first, module.second, file)) {
+                reloadStats.failures++;
+                log(LogLevel::Error, [&](std::ostream& out) {
+                    out << "Cannot load module " << module.first << ": " << (error.empty() ? lastError : error);
+                });
+            }
+        }
+    }
+    
+    // Watcher thread: swap in a changed module
+    void reloadModule(const std::string& name, const std::string& path,
+                      ModuleWatcher::Clock::time_point changed) {
+        ContextScope scope(*this);
+        if (!initialized) {
+            return;
+        }
+        
+        // Copied under the lock: a later save can neither change the bytes
+        // being compiled nor slip in between reading and loading
+        MappedFile file;
+        std::string error;
+        bool readable = file.open(path, error, MappedFile::Mode::Copy);
+        auto loaded = moduleStamps.find(name);
+        if (readable && loaded != moduleStamps.end() && loaded->second == file.stamp()) {
+            return;     // Already running this version
+        }
+        
+        // The outcome of the host's last job stays visible
+        std::string jobError = std::move(lastError);
+        ErrorCode jobErrorCode = lastErrorCode;
+        if (readable && loadModule(name, path, file)) {
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                ModuleWatcher::Clock::now() - changed);
+            reloadStats.reloads++;
+            reloadStats.last_latency = latency;
+            reloadStats.max_latency = std::max(reloadStats.max_latency, latency);
+            reloadStats.total_latency += latency;
+            log(LogLevel::Info, [&](std::ostream& out) {
+                out << "Reloaded module " << name << " in " << latency.count() << " us";
+            });
+        } else {
+            reloadStats.failures++;
+            log(LogLevel::Error, [&](std::ostream& out) {
+                out << "Cannot reload module " << name << ": " << (readable ? lastError : error);
+            });
+        }
+        lastError = std::move(jobError);
+        lastErrorCode = jobErrorCode;
+    }
+    
+    // Forget resolved functions; executed code may rebind them
+    void clearFunctionCache() {
+#if USE_REAL_MICROPYTHON
+        for (const auto& entry : functionCache) {
+            mp_embed_obj_unpin(entry.second);
+        }
+#endif
+        functionCache.clear();
+    }
+    
+#if USE_REAL_MICROPYTHON
+    mp_embed_obj_t lookupFunction(std::string_view name) {
+        auto it = functionCache.find(name);
+        if (it != functionCache.end()) {
+            return it->second;
+        }
+        mp_embed_obj_t function = mp_embed_lookup(name.data(), name.size());
+        if (function == MP_EMBED_OBJ_NULL) {
+            setError(ErrorCode::PythonException, mp_embed_error_message());
+            return MP_EMBED_OBJ_NULL;
+        }
+        functionCache.emplace(std::string(name), function);
+        return function;
+    }
+    
+    // Create the object for an argument; containers are created empty and
+    // filled by fill() once they are reachable from a root
+    static mp_embed_obj_t create(const CallArg& arg) {
+        switch (arg.kind) {
+        case CallArg::Kind::Object:
+            return arg.object;
+        case CallArg::Kind::Int:
+            return mp_embed_obj_new_int(arg.integer);
+        case CallArg::Kind::Float:
+            return mp_embed_obj_new_float(arg.real);
+        case CallArg::Kind::String:
+            return mp_embed_obj_new_str(arg.string.data, arg.string.size);
+        case CallArg::Kind::List:
+            return mp_embed_obj_new_list(arg.list.size);
+        }
+        return MP_EMBED_OBJ_NULL;
+    }
+    
+    static bool fill(const CallArg& arg, mp_embed_obj_t object) {
+        if (arg.kind != CallArg::Kind::List) {
+            return true;
+        }
+        for (size_t i = 0; i < arg.list.size; i++) {
+            CallArg element;
+            arg.list.element(arg.list.data, i, element);
+            mp_embed_obj_t item = create(element);
+            if (item == MP_EMBED_OBJ_NULL) {
+                return false;
+            }
+            mp_embed_obj_set_item(object, i, item);
+            if (!fill(element, item)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // Convert an argument straight into a rooted slot
+    bool toObject(const CallArg& arg, mp_embed_obj_t& slot) {
+        slot = create(arg);
+        if (slot == MP_EMBED_OBJ_NULL || !fill(arg, slot)) {
+            slot = MP_EMBED_OBJ_NONE;
+            if (!quotaExceeded()) {
+                setError(ErrorCode::ResourceError, "MemoryError: memory allocation failed");
+            }
+            return false;
+        }
+        return true;
+    }
+#endif
+    
+    /**
+     * Reserves call slots for the duration of one call
+     */
+    class CallFrame {
+    public:
+        CallFrame(Impl& impl, size_t count)
+            : impl(impl), base(impl.callSlotsUsed), count(count) {
+            if (valid()) {
+                impl.callSlotsUsed += count;
+            }
+        }
+        ~CallFrame() {
+            if (valid()) {
+                // Drop the references so the objects can be collected
+                std::fill_n(slots(), count, MP_EMBED_OBJ_NONE);
+                impl.callSlotsUsed = base;
+            }
+        }
+        
+        bool valid() const {
+            return base + count <= impl.callSlots.size();
+        }
+        
+        mp_embed_obj_t* slots() {
+            return impl.callSlots.data() + base;
+        }
+    
+    private:
+        Impl& impl;
+        size_t base;
+        size_t count;
+        
+        CallFrame(const CallFrame&) = delete;
+        CallFrame& operator=(const CallFrame&) = delete;
+    };
+    
+    // Detach an exposed buffer from Python (context must be current)
+    void detachBuffer(BufferState& state) {
+#if USE_REAL_MICROPYTHON
+        mp_embed_buffer_release(state.buffer);
+        state.buffer = nullptr;
+#endif
+        state.engine = nullptr;
+    }
+    
+    void releaseBuffer(const std::shared_ptr<BufferState>& state) {
+        detachBuffer(*state);
+        buffers.erase(std::remove(buffers.begin(), buffers.end(), state), buffers.end());
+    }
+    
+    // The memoryview objects live on the heap, detach them before it goes
+    void detachBuffers() {
+        for (const auto& state : buffers) {
+            detachBuffer(*state);
+        }
+        buffers.clear();
+    }
+    
+    // Default emitter of the VM (after init, soft reset and restore)
+    void applyEmitter() {
+#if USE_REAL_MICROPYTHON
+        mp_embed_set_emitter(config.emitter == CodeEmitter::Native ? MP_EMBED_EMIT_NATIVE :
+                             config.emitter == CodeEmitter::Viper ? MP_EMBED_EMIT_VIPER :
+                             MP_EMBED_EMIT_BYTECODE);
+#endif
+    }
+    
+    // Push the GC mode and threshold into the VM (context must be current)
+    void applyGcConfig() {
+        autoCollect = config.enable_gc && config.gc_mode != GcMode::Manual;
+#if USE_REAL_MICROPYTHON
+        // Idle mode keeps collection in allocations only as the heap-full fallback
+        mp_embed_gc_set_auto(autoCollect ? 1 : 0);
+        mp_embed_gc_set_threshold(config.gc_mode == GcMode::Automatic ? config.gc_threshold : 0);
+#endif
+    }
+    
+    // Run one collection and fold its pause into the estimate
+    void collect() {
+        auto start = std::chrono::steady_clock::now();
+#if USE_REAL_MICROPYTHON
+        mp_embed_gc_collect();
+#endif
+        auto pause = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+#if !USE_REAL_MICROPYTHON
+        stubCollections++;
+        stubGcTime += pause;
+#endif
+        double pauseUs = static_cast<double>(pause.count());
+        gcPauseEstimateUs = gcPauseKnown ? 0.75 * gcPauseEstimateUs + 0.25 * pauseUs : pauseUs;
+        gcPauseKnown = true;
+    }
+    
+    // Whether a collection is expected to finish within the budget
+    bool fitsBudget(std::chrono::microseconds budget) const {
+        return !gcPauseKnown || gcPauseEstimateUs <= static_cast<double>(budget.count());
+    }
+    
+    size_t allocatedSinceGc() const {
+#if USE_REAL_MICROPYTHON
+        mp_embed_heap_info_t info;
+        mp_embed_heap_info(&info);
+        return info.alloc_since_gc;
+#else
+        return 0;
+#endif
+    }
+    
+    // Collect between jobs when GcMode::Idle is due (context must be current)
+    bool collectIfIdle(std::chrono::microseconds budget) {
+        if (!initialized || config.gc_mode != GcMode::Idle || !config.enable_gc) {
+            return false;
+        }
+        size_t allocated = allocatedSinceGc();
+        if (allocated == 0 || allocated < config.gc_threshold || !fitsBudget(budget)) {
+            return false;
+        }
+        collect();
+        return true;
+    }
+    
+    /**
+     * Locks the engine and makes its VM context current on the calling
+     * thread for the duration of a call into MicroPython
+     */
+    class ContextScope {
+    public:
+#if USE_REAL_MICROPYTHON
+        explicit ContextScope(Impl& impl)
+            : lock(impl.vmMutex),
+              previous(mp_embed_ctx_enter(impl.ctx, &stack_marker)) {}
+        ~ContextScope() {
+            mp_embed_ctx_leave(previous);
+        }
+    
+    private:
+        std::lock_guard<std::recursive_mutex> lock;
+        int stack_marker = 0;  // Approximates the caller's stack top
+        mp_embed_ctx_t* previous;
+#else
+        explicit ContextScope(Impl& impl)
+            : lock(impl.vmMutex) {}
+    
+    private:
+        std::lock_guard<std::recursive_mutex> lock;
+#endif
+    
+        ContextScope(const ContextScope&) = delete;
+        ContextScope& operator=(const ContextScope&) = delete;
+    };
+    
+    // Queue a job for the executor thread
+    void submitAsync(std::unique_ptr<AsyncTask> task) {
+        if (!executorRunning.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(executorMutex);
+            if (!executorRunning.load(std::memory_order_relaxed)) {
+                executorStop.store(false);
+                executor = std::thread([this] { executorLoop(); });
+                executorRunning.store(true, std::memory_order_release);
+            }
+        }
+        
+        // Count before pushing so the executor never sees a negative count
+        asyncPending.fetch_add(1);
+        asyncQueue.push(std::move(task));
+        if (executorSleeping.load()) {
+            std::lock_guard<std::mutex> lock(executorMutex);
+            executorCv.notify_one();
+        }
+    }
+    
+    void executorLoop() {
+        while (true) {
+            std::unique_ptr<AsyncTask> task = asyncQueue.pop();
+            if (task) {
+                asyncPending.fetch_sub(1);
+                runAsync(*task);
+                continue;
+            }
+            if (asyncPending.load() > 0) {
+                // A producer is between its two push steps
+                std::this_thread::yield();
+                continue;
+            }
+            if (executorStop.load()) {
+                break;
+            }
+            
+            // Nothing queued: a good moment for a deferred collection
+            {
+                ContextScope scope(*this);
+                collectIfIdle(std::chrono::microseconds::max());
+            }
+            
+            std::unique_lock<std::mutex> lock(executorMutex);
+            executorSleeping.store(true);
+            executorCv.wait(lock, [this] {
+                return asyncPending.load() > 0 || executorStop.load();
+            });
+            executorSleeping.store(false);
+        }
+    }
+    
+    void runAsync(AsyncTask& task) {
+        AsyncJobState& state = *task.state;
+        ExecutionResult result;
+        bool skip = false;
+        {
+            std::lock_guard<std::mutex> lock(executorMutex);
+            runningJob = &state;
+        }
+        {
+            // Running only once the VM is ours, so an interrupt meant for
+            // this job never hits a job of another thread
+            ContextScope scope(*this);
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                if (state.cancelled) {
+                    result.error = "Cancelled";
+                    result.code = ErrorCode::Interrupted;
+                    skip = true;
+                } else if (executorStop.load()) {
+                    result.error = "Engine shut down";
+                    result.code = ErrorCode::InvalidState;
+                    skip = true;
+                } else {
+                    state.status = AsyncJobState::Status::Running;
+                }
+            }
+            
+            if (!skip) {
+                result.success = executeSource(task.code, "<async>");
+                if (!result.success) {
+                    result.error = lastError;
+                    result.code = lastErrorCode;
+                }
+            }
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (state.cancelled && !result.success) {
+                result.error = "Cancelled";
+                result.code = ErrorCode::Interrupted;
+            }
+            state.status = AsyncJobState::Status::Done;
+        }
+        {
+            std::lock_guard<std::mutex> lock(executorMutex);
+            runningJob = nullptr;
+        }
+        if (!skip) {
+            // cancel() can no longer interrupt this job; drop a late interrupt
+            ContextScope scope(*this);
+            clearInterrupt();
+        }
+        
+        if (task.callback) {
+            try {
+                task.callback(result);
+            } catch (const std::exception& e) {
+                log(LogLevel::Error, [&](std::ostream& out) {
+                    out << "Async callback failed: " << e.what();
+                });
+            }
+        }
+        task.promise.set_value(std::move(result));
+    }
+    
+    // Stop the executor, failing jobs that have not started
+    void stopExecutor() {
+        std::unique_lock<std::mutex> lock(executorMutex);
+        if (!executorRunning.load()) {
+            return;
+        }
+        executorStop.store(true);
+        bool interrupted = false;
+        if (runningJob) {
+            // Only an async job in flight; a synchronous job of another
+            // thread must not see an interrupt
+            std::lock_guard<std::mutex> jobLock(runningJob->mutex);
+            if (runningJob->status == AsyncJobState::Status::Running) {
+                interrupt();
+                interrupted = true;
+            }
+        }
+        executorCv.notify_one();
+        lock.unlock();
+        executor.join();
+        lock.lock();
+        executorRunning.store(false);
+        if (interrupted) {
+            ContextScope scope(*this);
+            clearInterrupt();
+        }
+    }
+    
+#if !USE_REAL_MICROPYTHON
+    // Stub implementation - simulate execution, false if interrupted
+    bool simulateExecution(const std::string& code) {
+        log(LogLevel::Debug, [&](std::ostream& out) {
+            out << "Executing Python code:\n>>> " << code;
+        });
+        
+        // An endless loop only ends when the engine is interrupted
+        if (code.find("while True") != std::string::npos) {
+            while (!stubInterrupt.exchange(false)) {
+                std::this_thread::yield();
+            }
+            write("KeyboardInterrupt\n", 18);
+            return false;
+        }
+        
+        // Simulate some basic Python code execution
+        if (code.find("print") != std::string::npos) {
+            // Extract and simulate print statements
+            size_t start = code.find("print(");
+            if (start != std::string::npos) {
+                start += 6; // Skip "print("
+                size_t end = code.find(")", start);
+                if (end != std::string::npos) {
+                    std::string content = code.substr(start, end - start);
+                    // Remove quotes if present
+                    if (content.front() == '"' && content.back() == '"') {
+                        content = content.substr(1, content.length() - 2);
+                    }
+                    content += '\n';
+                    write(content.data(), content.size());
+                }
+            }
+        }
+        
+        // Simulate imports resolved from frozen modules
+        size_t import = code.find("import ");
+        if (import != std::string::npos) {
+            size_t start = import + 7;
+            size_t end = code.find_first_of(" \t\r\n,", start);
+            std::string file = code.substr(start, end - start) + ".py";
+            for (const std::string& frozen : MicroPythonEngine::getFrozenModules()) {
+                if (frozen == file) {
+                    log(LogLevel::Debug, [&](std::ostream& out) {
+                        out << "Import resolved from frozen module " << frozen;
+                    });
+                }
+            }
+        }
+        return true;
+    }
+#endif
+};
+
+// Constructor
+MicroPythonEngine::MicroPythonEngine() 
+    : pImpl(std::make_unique<Impl>()) {
+}
+
+// Destructor
+MicroPythonEngine::~MicroPythonEngine() {
+    if (isInitialized()) {
+        shutdown();
+    }
+}
+
+// Initialize the MicroPython engine
+bool MicroPythonEngine::initialize(const MicroPythonConfig& config) {
+    if (pImpl->initialized) {
+        pImpl->setError(ErrorCode::InvalidState, "Engine already initialized");
+        return false;
+    }
+    
+    if (!hasEmitter(config.emitter)) {
+        pImpl->setError(ErrorCode::Unsupported, "Native code emitter not built in (MICROPYTHON_NATIVE_EMITTER)");
+        return false;
+    }
+    
+    try {
+        // Store configuration
+        pImpl->config = config;
+        pImpl->codeCache.setCapacity(config.code_cache_size);
+        
+        // Allocate heap memory, or reuse the heap of a previous initialize()
+        if (!pImpl->heap.acquire(config, pImpl->lastError)) {
+            pImpl->lastErrorCode = ErrorCode::ResourceError;
+            return false;
+        }
+        
+#if USE_REAL_MICROPYTHON
+        if (!pImpl->ensureContext()) {
+            pImpl->cleanup();
+            return false;
+        }
+        
+        // Initialize MicroPython runtime with real implementation
+        int stack_top = 0;
+        Impl::ContextScope scope(*pImpl);
+        mp_embed_init(pImpl->heap.data(), config.heap_size, &stack_top);
+        pImpl->applyGcConfig();
+        pImpl->applyEmitter();
+        pImpl->registerRoots();
+        pImpl->installModules();
+        
+        pImpl->log(LogLevel::Info, [&](std::ostream& out) {
+            out << "Real MicroPython engine initialized with " << config.heap_size
+                << " bytes heap (" << pImpl->heap.describe() << ")";
+        });
+#else
+        // Stub implementation
+        pImpl->applyGcConfig();
+        pImpl->applyEmitter();
+        pImpl->log(LogLevel::Info, [&](std::ostream& out) {
+            out << "Stub MicroPython engine initialized with " << config.heap_size
+                << " bytes heap (" << pImpl->heap.describe() << ")";
+        });
+#endif
+        
+        pImpl->initialized = true;
+        pImpl->lastError.clear();
+        
+        return true;
+    } catch (const std::exception& e) {
+        pImpl->setError(ErrorCode::Internal, std::string("Initialization failed: ") + e.what());
+        pImpl->cleanup();
+        return false;
+    }
+}
+
+// Initialize the engine from a snapshot image
+bool MicroPythonEngine::initializeFromSnapshot(const std::string& path, const MicroPythonConfig& config) {
+    if (pImpl->initialized) {
+        pImpl->setError(ErrorCode::InvalidState, "Engine already initialized");
+        return false;
+    }
+    
+    if (!hasEmitter(config.emitter)) {
+        pImpl->setError(ErrorCode::Unsupported, "Native code emitter not built in (MICROPYTHON_NATIVE_EMITTER)");
+        return false;
+    }
+    
+    try {
+        SnapshotImage image;
+        if (!loadSnapshot(path, Impl::buildId(), image, pImpl->heap, pImpl->lastError)) {
+            pImpl->lastErrorCode = ErrorCode::IoError;
+            return false;
+        }
+        pImpl->config = config;
+        pImpl->config.heap_size = image.heap_size;
+        pImpl->codeCache.setCapacity(config.code_cache_size);
+        
+#if USE_REAL_MICROPYTHON
+        if (!pImpl->ensureContext()) {
+            pImpl->heap.release();
+            return false;
+        }
+        
+        int stack_top = 0;
+        Impl::ContextScope scope(*pImpl);
+        if (mp_embed_snapshot_restore(pImpl->heap.data(), image.heap_size, image.state.data(),
+                                      image.state.size(), &stack_top) != MP_EMBED_OK) {
+            pImpl->setError(ErrorCode::IoError, "Snapshot state does not match this runtime");
+            pImpl->heap.release();
+            return false;
+        }
+        pImpl->applyGcConfig();
+        pImpl->applyEmitter();
+        pImpl->registerRoots();
+        pImpl->installModules();
+        
+        pImpl->log(LogLevel::Info, [&](std::ostream& out) {
+            out << "Real MicroPython engine restored from " << path << " ("
+                << image.heap_size << " bytes heap)";
+        });
+#else
+        pImpl->applyGcConfig();
+        pImpl->applyEmitter();
+        pImpl->log(LogLevel::Info, [&](std::ostream& out) {
+            out << "Stub MicroPython engine restored from " << path << " ("
+                << image.heap_size << " bytes heap)";
+        });
+#endif
+        
+        pImpl->initialized = true;
+        pImpl->lastError.clear();
+        return true;
+    } catch (const std::exception& e) {
+        pImpl->setError(ErrorCode::Internal, std::string("Initialization failed: ") + e.what());
+        pImpl->heap.release();
+        return false;
+    }
+}
+
+// Save the VM state to a snapshot image
+bool MicroPythonEngine::saveSnapshot(const std::string& path) {
+    if (!pImpl->initialized) {
+        pImpl->setError(ErrorCode::InvalidState, "Engine not initialized");
+        return false;
+    }
+    
+    if (!pImpl->heap.pageAligned()) {
+        pImpl->setError(ErrorCode::Unsupported, "Cannot snapshot a heap that is not page-aligned (heap_buffer)");
+        return false;
+    }
+    
+    try {
+        Impl::ContextScope scope(*pImpl);
+        
+        // Keep garbage out of the image
+        pImpl->collect();
+        
+        SnapshotImage image;
+        image.heap_address = reinterpret_cast<uintptr_t>(pImpl->heap.data());
+        image.heap_size = pImpl->heap.size();
+        image.build_id = Impl::buildId();
+#if USE_REAL_MICROPYTHON
+        mp_embed_heap_info_t info;
+        mp_embed_heap_info(&info);
+        if (info.exec_used) {
+            pImpl->setError(ErrorCode::Unsupported, "Cannot snapshot native code (it lives outside the heap)");
+            return false;
+        }
+        image.state.resize(mp_embed_snapshot_state_size());
+        if (mp_embed_snapshot_save(image.state.data(), image.state.size()) != MP_EMBED_OK) {
+            pImpl->setError(ErrorCode::Internal, "Failed to save VM state");
+            return false;
+        }
+#endif
+        if (!writeSnapshot(path, image, pImpl->heap.data(), pImpl->lastError)) {
+            pImpl->lastErrorCode = ErrorCode::IoError;
+            return false;
+        }
+        pImpl->lastError.clear();
+        return true;
+        
+    } catch (const std::exception& e) {
+        pImpl->setError(ErrorCode::Internal, std::string("Snapshot failed: ") + e.what());
+        return false;
+    }
+}
+
+// Shutdown the MicroPython engine
+void MicroPythonEngine::shutdown() {
+    if (!pImpl->initialized) {
+        return;
+    }
+    
+    try {
+        // Jobs that have not started fail, a running job is interrupted
+        pImpl->stopExecutor();
+        pImpl->watcher.stop();
+        pImpl->stopProfiling();
+        
+        Impl::ContextScope scope(*pImpl);
+        
+        // Cached code objects and buffer views must be released while the
+        // runtime is alive
+        pImpl->codeCache.clear();
+        pImpl->clearFunctionCache();
+        pImpl->detachBuffers();
+        
+#if USE_REAL_MICROPYTHON
+        // Cleanup MicroPython runtime with real implementation
+        mp_embed_deinit();
+        pImpl->log(LogLevel::Info, [](std::ostream& out) {
+            out << "Real MicroPython engine shutdown";
+        });
+#else
+        // Stub implementation cleanup
+        pImpl->log(LogLevel::Info, [](std::ostream& out) {
+            out << "Stub MicroPython engine shutdown";
+        });
+#endif
+        
+        pImpl->cleanup();
+        pImpl->initialized = false;
+        
+    } catch (const std::exception& e) {
+        pImpl->log(LogLevel::Error, [&](std::ostream& out) {
+            out << "Error during shutdown: " << e.what();
+        });
+    }
+}
+
+// Soft reset the engine in place
+bool MicroPythonEngine::reset() {
+    if (!pImpl->initialized) {
+        pImpl->setError(ErrorCode::InvalidState, "Engine not initialized");
+        return false;
+    }
+    
+    try {
+        Impl::ContextScope scope(*pImpl);
+        
+        // Compiled code, functions and buffer views live on the heap that is
+        // about to be wiped
+        pImpl->codeCache.clear();
+        pImpl->clearFunctionCache();
+        pImpl->detachBuffers();
+        
+#if USE_REAL_MICROPYTHON
+        if (mp_embed_reset() != MP_EMBED_OK) {
+            pImpl->setError(ErrorCode::Internal, "MicroPython soft reset failed");
+            return false;
+        }
+#endif
+        
+        // The VM is back to its defaults; reapply this engine's GC policy
+        pImpl->applyGcConfig();
+        pImpl->applyEmitter();
+        pImpl->registerRoots();
+        pImpl->installModules();
+        if (pImpl->watcher.active()) {
+            pImpl->loadWatchedModules();
+        }
+        pImpl->clearInterrupt();
+        pImpl->lastError.clear();
+        return true;
+        
+    } catch (const std::exception& e) {
+        pImpl->setError(ErrorCode::Internal, std::string("Reset failed: ") + e.what());
+        return false;
+    }
+}
+
+// Check if engine is initialized
+bool MicroPythonEngine::isInitialized() const {
+    return pImpl->initialized;
+}
+
+// Execute Python code from string
+bool MicroPythonEngine::executeString(const std::string& code) {
+    if (!pImpl->initialized) {
+        pImpl->setError(ErrorCode::InvalidState, "Engine not initialized");
+        return false;
+    }
+    
+    if (code.empty()) {
+        pImpl->setError(ErrorCode::InvalidArgument, "Empty code string");
+        return false;
+    }
+    
+    try {
+        Impl::ContextScope scope(*pImpl);
+        return pImpl->executeSource(code, "<string>");
+        
+    } catch (const std::exception& e) {
+        pImpl->setError(ErrorCode::Internal, std::string("Execution failed: ") + e.what());
+        return false;
+    }
+}
+
+// Execute Python code, capturing its output
+bool MicroPythonEngine::executeString(const std::string& code, std::string& output) {
+    Impl::ContextScope scope(*pImpl);
+    std::string* previous = pImpl->capture;
+    pImpl->capture = &output;
+    bool result = executeString(code);
+    pImpl->capture = previous;
+    return result;
+}
+
+// Get the default output sink
+RingBufferSink& MicroPythonEngine::outputBuffer() {
+    return pImpl->outputRing;
+}
+
+// Execute Python file
+bool MicroPythonEngine::executeFile(const std::string& filename) {
+    if (!pImpl->initialized) {
+        pImpl->setError(ErrorCode::InvalidState, "Engine not initialized");
+        return false;
+    }
+    
+    try {
+        Impl::ContextScope scope(*pImpl);
+        
+        // Reuse compiled code while stat() shows the file unchanged; a hit
+        // neither opens nor reads the file
+        FileStamp stamp;
+        if (pImpl->codeCache.enabled() && statFile(filename, stamp)) {
+            CompiledCode compiled = pImpl->codeCache.findFile(filename, stamp);
+            if (compiled) {
+                return pImpl->run(compiled);
+            }
+        }
+        
+        // Map the file and compile straight from the mapping
+        MappedFile file;
+        std::string error;
+        if (!file.open(filename, error)) {
+            pImpl->setError(ErrorCode::IoError, error);
+            return false;
+        }
+        if (file.size() == 0) {
+            pImpl->setError(ErrorCode::InvalidArgument, "Empty code string");
+            return false;
+        }
+        
+        CompiledCode compiled = pImpl->compile(std::string_view(file.data(), file.size()), filename.c_str());
+        if (!compiled) {
+            return false;
+        }
+        pImpl->codeCache.insertFile(filename, file.stamp(), compiled);
+        return pImpl->run(compiled);
+        
+    } catch (const std::exception& e) {
+        pImpl->setError(ErrorCode::Internal, std::string("File execution failed: ") + e.what());
+        return false;
+    }
+}
+
+// Execute precompiled .mpy bytecode from memory
+bool MicroPythonEngine::executeCompiled(const void* data, size_t len) {
+    if (!pImpl->initialized) {
+        pImpl->setError(ErrorCode::InvalidState, "Engine not initialized");
+        return false;
+    }
+    
+    try {
+        Impl::ContextScope scope(*pImpl);
+        CompiledCode compiled = pImpl->load(data, len, "<mpy>");
+        if (!compiled) {
+            return false;
+        }
+        return pImpl->run(compiled);
+        
+    } catch (const std::exception& e) {
+        pImpl->setError(ErrorCode::Internal, std::string("Execution failed: ") + e.what());
+        return false;
+    }
+}
+
+// Execute precompiled .mpy file
+bool MicroPythonEngine::executeCompiledFile(const std::string& filename) {
+    if (!pImpl->initialized) {
+        pImpl->setError(ErrorCode::InvalidState, "Engine not initialized");
+        return false;
+    }
+    
+    try {
+        Impl::ContextScope scope(*pImpl);
+        
+        FileStamp stamp;
+        if (pImpl->codeCache.enabled() && statFile(filename, stamp)) {
+            CompiledCode compiled = pImpl->codeCache.findFile(filename, stamp);
+            if (compiled) {
+                return pImpl->run(compiled);
+            }
+        }
+        
+        MappedFile file;
+        std::string error;
+        if (!file.open(filename, error)) {
+            pImpl->setError(ErrorCode::IoError, error);
+            return false;
+        }
+        
+        CompiledCode compiled = pImpl->load(file.data(), file.size(), filename.c_str());
+        if (!compiled) {
+            return false;
+        }
+        pImpl->codeCache.insertFile(filename, file.stamp(), compiled);
+        return pImpl->run(compiled);
+        
+    } catch (const std::exception& e) {
+        pImpl->setError(ErrorCode::Internal, std::string("File execution failed: ") + e.what());
+        return false;
+    }
+}
+
+// Execute Python code asynchronously
+AsyncJob MicroPythonEngine::executeAsync(const std::string& code, AsyncCallback callback) {
+    AsyncJob job;
+    job.state = std::make_shared<AsyncJobState>();
+    job.state->engine = this;
+    
+    std::string error;
+    if (!pImpl->initialized) {
+        error = "Engine not initialized";
+    } else if (code.empty()) {
+        error = "Empty code string";
+    }
+    if (!error.empty()) {
+        ExecutionResult result;
+        result.success = false;
+        result.error = error;
+        result.code = pImpl->initialized ? ErrorCode::InvalidArgument : ErrorCode::InvalidState;
+        job.state->status = AsyncJobState::Status::Done;
+        if (callback) {
+            callback(result);
+        }
+        std::promise<ExecutionResult> promise;
+        promise.set_value(std::move(result));
+        job.result = promise.get_future();
+        return job;
+    }
+    
+    auto task = std::make_unique<Impl::AsyncTask>();
+    task->code = code;
+    task->callback = std::move(callback);
+    task->state = job.state;
+    job.result = task->promise.get_future();
+    pImpl->submitAsync(std::move(task));
+    return job;
+}
+
+// Cancel an asynchronous job
+bool AsyncJob::cancel() {
+    if (!state) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->status == AsyncJobState::Status::Done) {
+        return false;
+    }
+    if (!state->cancelled) {
+        state->cancelled = true;
+        if (state->status == AsyncJobState::Status::Running) {
+            state->engine->pImpl->interrupt();
+        }
+    }
+    return true;
+}
+
+// Expose host memory to Python
+BufferHandle MicroPythonEngine::exposeRawBuffer(const std::string& name, void* data, size_t len,
+                                                char typecode, bool writable) {
+    BufferHandle handle;
+    if (!pImpl->initialized) {
+        pImpl->setError(ErrorCode::InvalidState, "Engine not initialized");
+        return handle;
+    }
+    if (name.empty()) {
+        pImpl->setError(ErrorCode::InvalidArgument, "Empty buffer name");
+        return handle;
+    }
+    
+    Impl::ContextScope scope(*pImpl);
+    auto state = std::make_shared<BufferState>();
+#if USE_REAL_MICROPYTHON
+    state->buffer = mp_embed_buffer_new(name.c_str(), data, len, typecode,
+                                        writable ? MP_EMBED_BUFFER_WRITABLE : MP_EMBED_BUFFER_READONLY);
+    if (!state->buffer) {
+        pImpl->setError(ErrorCode::ResourceError, "Failed to expose buffer: " + name);
+        return handle;
+    }
+#else
+    (void)data;
+    pImpl->log(LogLevel::Debug, [&](std::ostream& out) {
+        out << "Exposed buffer " << name << " = memoryview('" << typecode << "', "
+            << len << " bytes" << (writable ? "" : ", read-only") << ")";
+    });
+#endif
+    state->engine = this;
+    state->name = name;
+    pImpl->buffers.push_back(state);
+    handle.state = std::move(state);
+    pImpl->lastError.clear();
+    return handle;
+}
+
+// Detach a buffer from Python
+void BufferHandle::release() {
+    if (state && state->engine) {
+        // Waits for a script that may be using the buffer to finish
+        MicroPythonEngine::Impl& impl = *state->engine->pImpl;
+        MicroPythonEngine::Impl::ContextScope scope(impl);
+        impl.releaseBuffer(state);
+    }
+    state.reset();
+}
+
+// Check whether Python can still reach the buffer
+bool BufferHandle::attached() const {
+    return state && state->engine;
+}
+
+// Call a Python function with converted arguments
+bool MicroPythonEngine::invokeFunction(std::string_view function, const CallArg* args, size_t count,
+                                       ResultDecoder decode, void* out) {
+    if (!pImpl->initialized) {
+        pImpl->setError(ErrorCode::InvalidState, "Engine not initialized");
+        return false;
+    }
     
 #if USE_REAL_MICROPYTHON
-    int stack_top_marker;  // For stack control
-#endif
+    Impl::ContextScope scope(*pImpl);
+    mp_embed_obj_t callable = pImpl->lookupFunction(function);
+    if (callable == MP_EMBED_OBJ_NULL) {
+        return false;
+    }
+    Impl::JobScope job(*pImpl);
     
-    Impl() = default;
-    ~Impl() {
-        cleanup();
+    // Arguments and result live in rooted slots while the call runs
+    Impl::CallFrame frame(*pImpl, count + 1);
+    if (!frame.valid()) {
+        pImpl->setError(ErrorCode::InvalidState, "Calls nested too deeply");
+        return false;
+    }
+    mp_embed_obj_t* slots = frame.slots();
+    for (size_t i = 0; i < count; i++) {
+        if (!pImpl->toObject(args[i], slots[i])) {
+            return false;
+        }
     }
     
-    void cleanup() {
-        if (heap_memory) {
-            delete[] heap_memory;
-            heap_memory = nullptr;
+    int result = mp_embed_call(callable, count, slots, &slots[count]);
+    if (result == MP_EMBED_INTERRUPTED) {
+        pImpl->setInterrupted();
+        return false;
+    } else if (result != MP_EMBED_OK) {
+        if (!pImpl->quotaExceeded()) {
+            pImpl->setError(ErrorCode::PythonException, std::string(function) + ": " + mp_embed_error_message());
         }
+        return false;
+    }
+    if (decode && !decode(PythonValue(slots[count]), out)) {
+        pImpl->setError(ErrorCode::ConversionError, "Cannot convert result of " + std::string(function));
+        return false;
+    }
+    pImpl->lastError.clear();
+    return true;
+#else
+    (void)function;
+    (void)args;
+    (void)count;
+    (void)decode;
+    (void)out;
+    pImpl->setError(ErrorCode::Unsupported, "Function calls require the MicroPython runtime (USE_REAL_MICROPYTHON)");
+    return false;
+#endif
+}
+
+// Call a Python function over a batch of inputs
+bool MicroPythonEngine::invokeBatch(std::string_view function, const void* inputs, size_t count,
+                                    BatchArgFn arguments, BatchResultFn decode, void* outputs,
+                                    std::vector<BatchItemError>& errors) {
+    if (!pImpl->initialized) {
+        pImpl->setError(ErrorCode::InvalidState, "Engine not initialized");
+        return false;
     }
     
 #if USE_REAL_MICROPYTHON
+    // Lock, context switch, lookup and slot reservation happen once
+    Impl::ContextScope scope(*pImpl);
+    mp_embed_obj_t callable = pImpl->lookupFunction(function);
+    if (callable == MP_EMBED_OBJ_NULL) {
+        return false;
+    }
+    Impl::JobScope job(*pImpl);     // Bounds the whole batch
+    Impl::CallFrame frame(*pImpl, MaxCallArgs + 1);
+    if (!frame.valid()) {
+        pImpl->setError(ErrorCode::InvalidState, "Calls nested too deeply");
+        return false;
+    }
+    mp_embed_obj_t* slots = frame.slots();
+    CallArg args[MaxCallArgs];
     
-    // Execute Python code using real MicroPython
-    bool executeStringReal(const std::string& code) {
-        // Use the simplified embed API
-        int result = mp_embed_exec_str(code.c_str());
-        if (result == 0) {
-            lastError.clear();
-            return true;
+    for (size_t i = 0; i < count; i++) {
+        size_t n = arguments(inputs, i, args);
+        bool converted = true;
+        for (size_t j = 0; j < n && converted; j++) {
+            converted = pImpl->toObject(args[j], slots[j]);
+        }
+        
+        if (!converted) {
+            errors.push_back(BatchItemError{i, pImpl->lastError});
         } else {
-            lastError = "MicroPython execution failed with code: " + std::to_string(result);
-            return false;
+            int result = mp_embed_call(callable, n, slots, &slots[n]);
+            if (result == MP_EMBED_INTERRUPTED) {
+                pImpl->setInterrupted();
+                return false;
+            } else if (result != MP_EMBED_OK) {
+                errors.push_back(BatchItemError{i, pImpl->quotaExceeded() ? pImpl->lastError
+                                                                          : mp_embed_error_message()});
+            } else if (!decode(PythonValue(slots[n]), outputs, i)) {
+                errors.push_back(BatchItemError{i, "Cannot convert result of " + std::string(function)});
+            }
         }
+        
+        // Let the item's objects be collected
+        std::fill_n(slots, n + 1, MP_EMBED_OBJ_NONE);
     }
+    pImpl->lastError.clear();
+    return true;
+#else
+    (void)function;
+    (void)inputs;
+    (void)count;
+    (void)arguments;
+    (void)decode;
+    (void)outputs;
+    (void)errors;
+    pImpl->setError(ErrorCode::Unsupported, "Function calls require the MicroPython runtime (USE_REAL_MICROPYTHON)");
+    return false;
 #endif
-};
+}
 
-// Constructor
-MicroPythonEngine::MicroPythonEngine() 
-    : pImpl(std::make_unique<Impl>()) {
+// Drop cached function lookups
+void MicroPythonEngine::clearFunctionCache() {
+    Impl::ContextScope scope(*pImpl);
+    pImpl->clearFunctionCache();
 }
 
-// Destructor
-MicroPythonEngine::~MicroPythonEngine() {
-    if (isInitialized()) {
-        shutdown();
+// Get or create a native module
+NativeModule& MicroPythonEngine::registerModule(const std::string& name) {
+    Impl::ContextScope scope(*pImpl);
+    for (const auto& module : pImpl->modules) {
+        if (module->name() == name) {
+            return *module;
+        }
+    }
+    pImpl->modules.emplace_back(new NativeModule(*this, name));
+    NativeModule& module = *pImpl->modules.back();
+    if (pImpl->initialized) {
+        pImpl->installModule(module);
     }
+    return module;
 }
 
-// Initialize the MicroPython engine
-bool MicroPythonEngine::initialize(const MicroPythonConfig& config) {
+// Re-register a module after def()
+void MicroPythonEngine::installModule(const NativeModule& module) {
+    Impl::ContextScope scope(*pImpl);
     if (pImpl->initialized) {
-        pImpl->lastError = "Engine already initialized";
-        return false;
+        pImpl->installModule(module);
     }
-    
-    try {
-        // Store configuration
-        pImpl->config = config;
-        
-        // Allocate heap memory
-        pImpl->heap_memory = new char[config.heap_size];
-        if (!pImpl->heap_memory) {
-            pImpl->lastError = "Failed to allocate heap memory";
-            return false;
-        }
-        
+}
+
+// Add a function to a native module
+NativeModule& NativeModule::add(const std::string& name, Trampoline trampoline,
+                                std::unique_ptr<void, void (*)(void*)> target) {
+    // A replaced function stays alive until the VM no longer refers to it
+    std::unique_ptr<void, void (*)(void*)> replaced(nullptr, target.get_deleter());
+    auto it = std::find_if(functions_.begin(), functions_.end(),
+                           [&name](const Function& function) { return function.name == name; });
+    if (it != functions_.end()) {
+        replaced = std::move(it->target);
+        it->trampoline = trampoline;
+        it->target = std::move(target);
+    } else {
+        functions_.push_back(Function{name, trampoline, std::move(target)});
+    }
+    engine_.installModule(*this);
+    return *this;
+}
+
+// Box the result of a native function
+int NativeModule::box(const CallArg& value, mp_embed_obj_t* result) {
 #if USE_REAL_MICROPYTHON
-        // Initialize MicroPython runtime with real implementation
-        mp_embed_init(pImpl->heap_memory, config.heap_size, &pImpl->stack_top_marker);
-        
-        std::cout << "Real MicroPython engine initialized with " << config.heap_size 
-                  << " bytes heap" << std::endl;
+    static_assert(Ok == MP_EMBED_OK, "Trampolines must report success as MP_EMBED_OK");
+    *result = MicroPythonEngine::Impl::create(value);
+    if (*result == MP_EMBED_OBJ_NULL || !MicroPythonEngine::Impl::fill(value, *result)) {
+        return mp_embed_raise("MemoryError", "memory allocation failed");
+    }
+    return Ok;
 #else
-        // Stub implementation
-        std::cout << "Stub MicroPython engine initialized with " << config.heap_size 
-                  << " bytes heap" << std::endl;
-#endif
-        
-        pImpl->initialized = true;
-        pImpl->lastError.clear();
-        
-        return true;
-    } catch (const std::exception& e) {
-        pImpl->lastError = std::string("Initialization failed: ") + e.what();
-        pImpl->cleanup();
-        return false;
+    if (value.kind != CallArg::Kind::Object) {
+        return -1;
     }
+    *result = value.object;
+    return Ok;
+#endif
 }
 
-// Shutdown the MicroPython engine
-void MicroPythonEngine::shutdown() {
-    if (!pImpl->initialized) {
-        return;
-    }
-    
-    try {
+// Report a call with the wrong number of arguments
+int NativeModule::argumentCountError(size_t expected, size_t given) {
 #if USE_REAL_MICROPYTHON
-        // Cleanup MicroPython runtime with real implementation
-        mp_embed_deinit();
-        std::cout << "Real MicroPython engine shutdown" << std::endl;
+    char message[96];
+    snprintf(message, sizeof(message), "function takes %zu positional arguments but %zu were given",
+             expected, given);
+    return mp_embed_raise("TypeError", message);
 #else
-        // Stub implementation cleanup
-        std::cout << "Stub MicroPython engine shutdown" << std::endl;
+    (void)expected;
+    (void)given;
+    return -1;
 #endif
-        
-        pImpl->cleanup();
-        pImpl->initialized = false;
-        
-    } catch (const std::exception& e) {
-        std::cerr << "Error during shutdown: " << e.what() << std::endl;
-    }
 }
 
-// Check if engine is initialized
-bool MicroPythonEngine::isInitialized() const {
-    return pImpl->initialized;
+// Report an argument that cannot be converted
+int NativeModule::argumentTypeError(size_t index) {
+#if USE_REAL_MICROPYTHON
+    char message[64];
+    snprintf(message, sizeof(message), "can't convert argument %zu", index + 1);
+    return mp_embed_raise("TypeError", message);
+#else
+    (void)index;
+    return -1;
+#endif
 }
 
-// Execute Python code from string
-bool MicroPythonEngine::executeString(const std::string& code) {
-    if (!pImpl->initialized) {
-        pImpl->lastError = "Engine not initialized";
-        return false;
-    }
-    
-    if (code.empty()) {
-        pImpl->lastError = "Empty code string";
-        return false;
-    }
-    
-    try {
+// Turn a C++ exception into a Python exception
+int NativeModule::raise(const char* message) {
 #if USE_REAL_MICROPYTHON
-        // Use real MicroPython implementation
-        return pImpl->executeStringReal(code);
+    return mp_embed_raise("RuntimeError", message);
 #else
-        // Stub implementation - simulate execution
-        std::cout << "Executing Python code:" << std::endl;
-        std::cout << ">>> " << code << std::endl;
-        
-        // Simulate some basic Python code execution
-        if (code.find("print") != std::string::npos) {
-            // Extract and simulate print statements
-            size_t start = code.find("print(");
-            if (start != std::string::npos) {
-                start += 6; // Skip "print("
-                size_t end = code.find(")", start);
-                if (end != std::string::npos) {
-                    std::string content = code.substr(start, end - start);
-                    // Remove quotes if present
-                    if (content.front() == '"' && content.back() == '"') {
-                        content = content.substr(1, content.length() - 2);
-                    }
-                    std::cout << content << std::endl;
-                }
-            }
-        }
-        
-        pImpl->lastError.clear();
-        return true;
+    (void)message;
+    return -1;
 #endif
-        
-    } catch (const std::exception& e) {
-        pImpl->lastError = std::string("Execution failed: ") + e.what();
-        return false;
+}
+
+// Decode a boxed int
+bool PythonValue::toIntSlow(long long& out) const {
+#if USE_REAL_MICROPYTHON
+    return mp_embed_obj_get_int(object_, &out) == MP_EMBED_OK;
+#else
+    if (mp_embed_obj_is_bool(object_)) {
+        out = object_ == MP_EMBED_OBJ_TRUE;
+        return true;
     }
+    return false;
+#endif
 }
 
-// Execute Python file
-bool MicroPythonEngine::executeFile(const std::string& filename) {
-    if (!pImpl->initialized) {
-        pImpl->lastError = "Engine not initialized";
-        return false;
+// Decode a float (or boxed int)
+bool PythonValue::toDoubleSlow(double& out) const {
+#if USE_REAL_MICROPYTHON
+    return mp_embed_obj_get_float(object_, &out) == MP_EMBED_OK;
+#else
+    long long value = 0;
+    if (toIntSlow(value)) {
+        out = static_cast<double>(value);
+        return true;
     }
-    
-    try {
-        // Read file content
-        std::ifstream file(filename);
-        if (!file.is_open()) {
-            pImpl->lastError = "Cannot open file: " + filename;
-            return false;
-        }
-        
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        std::string code = buffer.str();
-        
-        // Execute the code
-        return executeString(code);
-        
-    } catch (const std::exception& e) {
-        pImpl->lastError = std::string("File execution failed: ") + e.what();
+    return false;
+#endif
+}
+
+// Check for a tuple or list
+bool PythonValue::isSequence() const {
+#if USE_REAL_MICROPYTHON
+    int type = mp_embed_obj_get_type(object_);
+    return type == MP_EMBED_TYPE_TUPLE || type == MP_EMBED_TYPE_LIST;
+#else
+    return false;
+#endif
+}
+
+// Copy a str
+bool PythonValue::toString(std::string& out) const {
+#if USE_REAL_MICROPYTHON
+    const char* data = nullptr;
+    size_t len = 0;
+    if (mp_embed_obj_get_str(object_, &data, &len) != MP_EMBED_OK) {
         return false;
     }
+    out.assign(data, len);
+    return true;
+#else
+    (void)out;
+    return false;
+#endif
+}
+
+// Get the length of a sequence or str
+bool PythonValue::size(size_t& out) const {
+#if USE_REAL_MICROPYTHON
+    return mp_embed_obj_get_len(object_, &out) == MP_EMBED_OK;
+#else
+    (void)out;
+    return false;
+#endif
+}
+
+// Get an item of a tuple or list
+PythonValue PythonValue::item(size_t index) const {
+#if USE_REAL_MICROPYTHON
+    return PythonValue(mp_embed_obj_get_item(object_, index));
+#else
+    (void)index;
+    return PythonValue(MP_EMBED_OBJ_NULL);
+#endif
 }
 
 // Get last error message
@@ -218,39 +1878,244 @@ std::string MicroPythonEngine::getLastError() const {
     return pImpl->lastError;
 }
 
+// Get the category of the last error
+ErrorCode MicroPythonEngine::getLastErrorCode() const {
+    return pImpl->lastError.empty() ? ErrorCode::None : pImpl->lastErrorCode;
+}
+
+// Interrupt running code
+void MicroPythonEngine::interrupt() {
+    pImpl->interrupt();
+}
+
 // Force garbage collection
 void MicroPythonEngine::collectGarbage() {
     if (!pImpl->initialized) {
         return;
     }
     
+    Impl::ContextScope scope(*pImpl);
+    pImpl->collect();
+}
+
+// Run garbage collection if it fits the pause budget
+bool MicroPythonEngine::collectGarbage(std::chrono::microseconds budget) {
+    if (!pImpl->initialized) {
+        return false;
+    }
+    
+    Impl::ContextScope scope(*pImpl);
+    if (!pImpl->fitsBudget(budget)) {
+        return false;
+    }
+    pImpl->collect();
+    return true;
+}
+
+// Collect between jobs if GcMode::Idle is due
+bool MicroPythonEngine::collectIfIdle(std::chrono::microseconds budget) {
+    Impl::ContextScope scope(*pImpl);
+    return pImpl->collectIfIdle(budget);
+}
+
+// Enable or disable collection inside allocations
+bool MicroPythonEngine::setAutoCollect(bool enabled) {
+    Impl::ContextScope scope(*pImpl);
+    bool previous = pImpl->autoCollect;
+    pImpl->autoCollect = enabled;
 #if USE_REAL_MICROPYTHON
-    // For now, we don't have direct access to gc_collect in embed API
-    // This would require more complex integration
-    std::cout << "Real garbage collection triggered (via embed API)" << std::endl;
-#else
-    // Stub implementation
-    std::cout << "Stub garbage collection triggered" << std::endl;
+    if (pImpl->initialized) {
+        mp_embed_gc_set_auto(enabled ? 1 : 0);
+    }
+#endif
+    return previous;
+}
+
+// Set the allocation threshold between collections
+void MicroPythonEngine::setGcThreshold(size_t bytes) {
+    Impl::ContextScope scope(*pImpl);
+    pImpl->config.gc_threshold = bytes;
+#if USE_REAL_MICROPYTHON
+    if (pImpl->initialized) {
+        mp_embed_gc_set_threshold(pImpl->config.gc_mode == GcMode::Automatic ? bytes : 0);
+    }
 #endif
 }
 
 // Get memory usage statistics
 size_t MicroPythonEngine::getMemoryUsage() const {
+    return getHeapStats().used;
+}
+
+// Get detailed heap statistics
+HeapStats MicroPythonEngine::getHeapStats() const {
+    HeapStats stats;
     if (!pImpl->initialized) {
-        return 0;
+        return stats;
+    }
+    
+#if USE_REAL_MICROPYTHON
+    Impl::ContextScope scope(*pImpl);
+    mp_embed_heap_info_t info;
+    mp_embed_heap_info(&info);
+    stats.total = info.total;
+    stats.used = info.used;
+    stats.free = info.free;
+    stats.largest_free = info.max_free;
+    stats.block_size = info.block_size;
+    stats.blocks_1 = info.num_1block;
+    stats.blocks_2 = info.num_2block;
+    stats.largest_block = info.max_block;
+    stats.allocated_since_gc = info.alloc_since_gc;
+    stats.allocations = info.allocations;
+    stats.collections = info.collections;
+    stats.gc_time = std::chrono::microseconds(info.gc_time_us);
+    stats.exec_used = info.exec_used;
+#else
+    // Stub implementation - the simulated VM keeps nothing on its heap
+    stats.total = pImpl->config.heap_size;
+    stats.free = pImpl->config.heap_size;
+    stats.largest_free = pImpl->config.heap_size;
+    stats.block_size = 16;
+    stats.collections = pImpl->stubCollections;
+    stats.gc_time = pImpl->stubGcTime;
+#endif
+    return stats;
+}
+
+// Load a directory of modules and keep them up to date
+bool MicroPythonEngine::watchModules(const std::string& directory) {
+    if (!pImpl->initialized) {
+        pImpl->setError(ErrorCode::InvalidState, "Engine not initialized");
+        return false;
+    }
+    
+    unwatchModules();
+    std::string error;
+    Impl* impl = pImpl.get();
+    bool started = pImpl->watcher.start(directory,
+        [impl](const std::string& name, const std::string& path, ModuleWatcher::Clock::time_point changed) {
+            impl->reloadModule(name, path, changed);
+        }, error);
+    if (!started) {
+        pImpl->setError(ErrorCode::IoError, error);
+        return false;
+    }
+    
+    // Changes from now on are picked up by the watcher
+    Impl::ContextScope scope(*pImpl);
+    pImpl->loadWatchedModules();
+    pImpl->lastError.clear();
+    return true;
+}
+
+// Stop watching modules
+void MicroPythonEngine::unwatchModules() {
+    pImpl->watcher.stop();
+}
+
+// Get hot reload statistics
+ReloadStats MicroPythonEngine::getReloadStats() const {
+    Impl::ContextScope scope(*pImpl);
+    return pImpl->reloadStats;
+}
+
+// Start sampling the code this engine runs
+bool MicroPythonEngine::startProfiling(std::chrono::microseconds interval) {
+    if (!pImpl->initialized) {
+        pImpl->setError(ErrorCode::InvalidState, "Engine not initialized");
+        return false;
     }
     
 #if USE_REAL_MICROPYTHON
-    // For now, we don't have direct access to gc_info in embed API
-    // Return simulated value
-    return pImpl->config.heap_size / 4; // Simulate 25% usage
+    std::lock_guard<std::mutex> lock(pImpl->profileMutex);
+    if (pImpl->profiling.exchange(false)) {
+        SamplingProfiler::instance().remove(pImpl->profile);
+    }
+    pImpl->profile.reset(interval);
+    pImpl->profile.request = &Impl::onSampleRequest;
+    pImpl->profile.data = pImpl.get();
+    pImpl->profiling.store(true);
+    SamplingProfiler::instance().add(pImpl->profile);
+    return true;
 #else
-    // Stub implementation - return simulated value
-    return pImpl->config.heap_size / 4; // Simulate 25% usage
+    (void)interval;
+    pImpl->setError(ErrorCode::Unsupported, "Profiling requires the MicroPython runtime (USE_REAL_MICROPYTHON)");
+    return false;
 #endif
 }
 
+// Stop sampling, keeping the samples
+void MicroPythonEngine::stopProfiling() {
+    pImpl->stopProfiling();
+}
+
+// Check if profiling is on
+bool MicroPythonEngine::isProfiling() const {
+    return pImpl->profiling.load();
+}
+
+// Get the samples as folded stacks
+std::string MicroPythonEngine::getProfile() const {
+    return pImpl->profile.folded();
+}
+
+// Get sampling profiler statistics
+ProfileStats MicroPythonEngine::getProfileStats() const {
+    ProfileStats stats;
+    stats.samples = pImpl->profile.samples();
+    stats.dropped = pImpl->profile.dropped();
+    stats.interval = pImpl->profile.interval();
+    return stats;
+}
+
+// Limit the memory of each job
+void MicroPythonEngine::setJobQuota(size_t allocBytes, size_t liveBytes) {
+    Impl::ContextScope scope(*pImpl);
+    pImpl->config.job_alloc_quota = allocBytes;
+    pImpl->config.job_live_quota = liveBytes;
+}
+
+// Get the memory used by the last job
+JobUsage MicroPythonEngine::getLastJobUsage() const {
+    Impl::ContextScope scope(*pImpl);
+    return pImpl->lastJobUsage;
+}
+
 // Get heap size
 size_t MicroPythonEngine::getHeapSize() const {
     return pImpl->initialized ? pImpl->config.heap_size : 0;
 }
+
+// Get compiled code cache statistics
+CodeCacheStats MicroPythonEngine::getCodeCacheStats() const {
+    Impl::ContextScope scope(*pImpl);
+    return pImpl->codeCache.stats();
+}
+
+// Drop all cached compiled code
+void MicroPythonEngine::clearCodeCache() {
+    Impl::ContextScope scope(*pImpl);
+    pImpl->codeCache.clear();
+}
+
+// Check whether a code emitter was built in
+bool MicroPythonEngine::hasEmitter(CodeEmitter emitter) {
+#if MICROPY_EMIT_X64
+    (void)emitter;
+    return true;
+#else
+    return emitter == CodeEmitter::Bytecode;
+#endif
+}
+
+// List modules frozen into the library
+std::vector<std::string> MicroPythonEngine::getFrozenModules() {
+    std::vector<std::string> modules;
+#if MICROPYTHON_FROZEN_MODULES
+    for (const char* name = mp_frozen_names; *name; name += modules.back().size() + 1) {
+        modules.emplace_back(name);
+    }
+#endif
+    return modules;
+}
@@ -6,23 +6,1666 @@
  * link against the actual MicroPython library.
  */
 
+#include <math.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "micropython_embed_stub.h"
+
+// .mpy header: 'M', format version, feature flags, small int bits
+#define STUB_MPY_VERSION 6
+#define STUB_MPY_HEADER_SIZE 4
+
+// Per-engine VM context. A real port keeps a complete mp_state_ctx_t here
+// and redirects MicroPython's global state to the context current on the
+// calling thread.
+struct _mp_embed_ctx_t {
+    void *heap;
+    size_t heap_size;
+    void *stack_top;
+    size_t stack_limit;
+    int initialized;
+    atomic_int interrupt_pending;
+    
+    // Heap accounting, in GC blocks
+    size_t blocks_used;
+    size_t num_1block;
+    size_t num_2block;
+    size_t max_block;
+    size_t alloc_since_gc;
+    unsigned long long allocations;
+    unsigned long long collections;
+    unsigned long long gc_time_us;
+    
+    // gc.enable()/gc.threshold() state
+    int gc_auto;
+    size_t gc_threshold;
+    
+    // Job quota (see mp_embed_quota_begin)
+    int quota_active;
+    size_t quota_max_alloc;
+    size_t quota_max_live;
+    size_t quota_live_base;         // Live bytes when the job started
+    mp_embed_quota_usage_t quota;
+    
+    // Objects: every heap object (for sweeping) and the embedder's roots
+    struct _stub_obj_t *objects;
+    mp_embed_obj_t *roots;
+    size_t n_roots;
+    char error[160];                // Last exception, "Type: message"
+    
+    // Modules registered by the embedder (outside the heap)
+    struct _stub_module_t *native_modules;
+    size_t n_native_modules;
+    
+    // sys.modules entries bound by mp_embed_module_load()
+    struct _stub_script_module_t *script_modules;
+    size_t n_script_modules;
+    
+    // Default emitter and the arena native code is emitted into
+    int emitter;
+    struct _stub_exec_chunk_t *exec_chunks;
+    size_t exec_used;
+    size_t exec_total;
+    
+    // Output routing (see mp_embed_ctx_set_output)
+    mp_embed_write_fn_t print_fn;
+    mp_embed_write_fn_t trace_fn;
+    void *output_data;
+    
+    // Sampling profiler hook (see mp_embed_profile_request)
+    atomic_int profile_pending;
+    mp_embed_sample_fn_t sample_fn;
+    void *sample_data;
+};
+
+#define STUB_GC_BLOCK_SIZE 16
+
+// What a snapshot records of the context besides the heap image
+#define STUB_SNAPSHOT_MAGIC 0x4d505353u
+typedef struct _stub_snapshot_state_t {
+    unsigned int magic;
+    size_t heap_size;
+    size_t blocks_used;
+    size_t num_1block;
+    size_t num_2block;
+    size_t max_block;
+    size_t alloc_since_gc;
+    int gc_auto;
+    size_t gc_threshold;
+} stub_snapshot_state_t;
+
+// Header in front of every stub heap allocation
+typedef struct _stub_alloc_t {
+    mp_embed_ctx_t *ctx;
+    size_t blocks;
+} stub_alloc_t;
+
+// Context used by callers that never create one (single-instance use)
+static mp_embed_ctx_t default_ctx;
+static _Thread_local mp_embed_ctx_t *current_ctx = NULL;
+
+static mp_embed_ctx_t *stub_ctx(void) {
+    return current_ctx ? current_ctx : &default_ctx;
+}
+
+// Format a message and hand it to fn (script output or trace)
+static void stub_vwrite(mp_embed_write_fn_t fn, void *data, const char *fmt, va_list args) {
+    if (!fn) {
+        return;
+    }
+    char buf[256];
+    va_list copy;
+    va_copy(copy, args);
+    int len = vsnprintf(buf, sizeof(buf), fmt, copy);
+    va_end(copy);
+    if (len < 0) {
+        return;
+    } else if ((size_t)len < sizeof(buf)) {
+        fn(data, buf, (size_t)len);
+    } else {
+        char *big = malloc((size_t)len + 1);
+        if (big) {
+            vsnprintf(big, (size_t)len + 1, fmt, args);
+            fn(data, big, (size_t)len);
+            free(big);
+        }
+    }
+}
+
+// Script output, like mp_printf(&mp_plat_print, ...)
+static void stub_print(const char *fmt, ...) {
+    mp_embed_ctx_t *ctx = stub_ctx();
+    va_list args;
+    va_start(args, fmt);
+    stub_vwrite(ctx->print_fn, ctx->output_data, fmt, args);
+    va_end(args);
+}
+
+// Diagnostics of the stub itself
+static void stub_trace(const char *fmt, ...) {
+    mp_embed_ctx_t *ctx = stub_ctx();
+    va_list args;
+    va_start(args, fmt);
+    stub_vwrite(ctx->trace_fn, ctx->output_data, fmt, args);
+    va_end(args);
+}
+
+static unsigned long long stub_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000ULL + (unsigned long long)ts.tv_nsec / 1000ULL;
+}
+
+static void stub_obj_sweep(mp_embed_ctx_t *ctx);
+
+// Collection frees objects unreachable from the registered roots and pinned
+// objects, and is counted and timed the way a real port's gc_collect() is.
+// Unlike a real port the stub does not scan the C stack.
+static void stub_gc_collect(mp_embed_ctx_t *ctx) {
+    unsigned long long start = stub_now_us();
+    stub_obj_sweep(ctx);
+    ctx->alloc_since_gc = 0;
+    ctx->collections++;
+    ctx->gc_time_us += stub_now_us() - start;
+}
+
+// Allocate from the current context's heap budget (NULL = MemoryError).
+// Memory comes from malloc, but is accounted like the GC heap would.
+static size_t stub_live_growth(mp_embed_ctx_t *ctx, size_t bytes) {
+    size_t live = ctx->blocks_used * STUB_GC_BLOCK_SIZE + bytes;
+    return live > ctx->quota_live_base ? live - ctx->quota_live_base : 0;
+}
+
+// Check an allocation against the job quota, collecting before giving up
+// on the live limit
+static int stub_quota_allows(mp_embed_ctx_t *ctx, size_t bytes) {
+    int exceeded = MP_EMBED_QUOTA_NONE;
+    if (ctx->quota_max_alloc && ctx->quota.allocated + bytes > ctx->quota_max_alloc) {
+        exceeded = MP_EMBED_QUOTA_ALLOC;
+    } else if (ctx->quota_max_live && stub_live_growth(ctx, bytes) > ctx->quota_max_live) {
+        if (ctx->gc_auto) {
+            stub_gc_collect(ctx);
+        }
+        if (stub_live_growth(ctx, bytes) > ctx->quota_max_live) {
+            exceeded = MP_EMBED_QUOTA_LIVE;
+        }
+    }
+    if (exceeded && !ctx->quota.exceeded) {
+        ctx->quota.exceeded = exceeded;
+    }
+    return exceeded == MP_EMBED_QUOTA_NONE;
+}
+
+static void *stub_gc_alloc(size_t size) {
+    mp_embed_ctx_t *ctx = stub_ctx();
+    size_t blocks = (size + STUB_GC_BLOCK_SIZE - 1) / STUB_GC_BLOCK_SIZE;
+    if (blocks == 0) {
+        blocks = 1;
+    }
+    if (ctx->gc_auto && ctx->gc_threshold && ctx->alloc_since_gc >= ctx->gc_threshold) {
+        stub_gc_collect(ctx);
+    }
+    if (ctx->quota_active && !stub_quota_allows(ctx, blocks * STUB_GC_BLOCK_SIZE)) {
+        return NULL;
+    }
+    if ((ctx->blocks_used + blocks) * STUB_GC_BLOCK_SIZE > ctx->heap_size) {
+        if (!ctx->gc_auto) {
+            return NULL;
+        }
+        stub_gc_collect(ctx);
+        if ((ctx->blocks_used + blocks) * STUB_GC_BLOCK_SIZE > ctx->heap_size) {
+            return NULL;
+        }
+    }
+    stub_alloc_t *alloc = malloc(sizeof(stub_alloc_t) + size);
+    if (!alloc) {
+        return NULL;
+    }
+    alloc->ctx = ctx;
+    alloc->blocks = blocks;
+    ctx->blocks_used += blocks;
+    ctx->alloc_since_gc += blocks * STUB_GC_BLOCK_SIZE;
+    ctx->allocations++;
+    if (blocks == 1) {
+        ctx->num_1block++;
+    } else if (blocks == 2) {
+        ctx->num_2block++;
+    }
+    if (blocks > ctx->max_block) {
+        ctx->max_block = blocks;
+    }
+    if (ctx->quota_active) {
+        ctx->quota.allocated += blocks * STUB_GC_BLOCK_SIZE;
+        size_t growth = stub_live_growth(ctx, 0);
+        if (growth > ctx->quota.peak_live) {
+            ctx->quota.peak_live = growth;
+        }
+    }
+    return alloc + 1;
+}
+
+static void stub_gc_free(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    stub_alloc_t *alloc = (stub_alloc_t *)ptr - 1;
+    mp_embed_ctx_t *ctx = alloc->ctx;
+    if (ctx->blocks_used >= alloc->blocks) {
+        ctx->blocks_used -= alloc->blocks;
+    }
+    if (alloc->blocks == 1 && ctx->num_1block) {
+        ctx->num_1block--;
+    } else if (alloc->blocks == 2 && ctx->num_2block) {
+        ctx->num_2block--;
+    }
+    free(alloc);
+}
+
+// Heap object of the stub's minimal object system. Functions may also be
+// static (not on the heap, never swept).
+typedef struct _stub_obj_t {
+    struct _stub_obj_t *next;       // Next heap object of the context
+    unsigned char type;             // MP_EMBED_TYPE_*
+    unsigned char on_heap;
+    unsigned char marked;
+    unsigned int pins;
+    size_t len;                     // Characters or items
+    union {
+        long long i;
+        double f;
+        char *s;
+        mp_embed_obj_t *items;
+        struct {
+            mp_embed_native_fn_t fn;
+            void *data;
+            const char *name;
+        } fun;
+    } u;
+} stub_obj_t;
+
+static stub_obj_t *stub_obj_ptr(mp_embed_obj_t obj) {
+    if (obj == MP_EMBED_OBJ_NULL || !mp_embed_obj_is_obj(obj) || (obj & 7) != 0) {
+        return NULL;
+    }
+    return mp_embed_obj_to_ptr(obj);
+}
+
+// Allocate an object with extra trailing bytes for its payload
+static stub_obj_t *stub_obj_alloc(int type, size_t extra) {
+    mp_embed_ctx_t *ctx = stub_ctx();
+    stub_obj_t *obj = stub_gc_alloc(sizeof(stub_obj_t) + extra);
+    if (!obj) {
+        snprintf(ctx->error, sizeof(ctx->error), "MemoryError: memory allocation failed");
+        return NULL;
+    }
+    memset(obj, 0, sizeof(*obj));
+    obj->type = (unsigned char)type;
+    obj->on_heap = 1;
+    obj->next = ctx->objects;
+    ctx->objects = obj;
+    return obj;
+}
+
+static void stub_obj_mark(mp_embed_obj_t handle) {
+    stub_obj_t *obj = stub_obj_ptr(handle);
+    if (!obj || !obj->on_heap || obj->marked) {
+        return;
+    }
+    obj->marked = 1;
+    if (obj->type == MP_EMBED_TYPE_TUPLE || obj->type == MP_EMBED_TYPE_LIST) {
+        for (size_t i = 0; i < obj->len; i++) {
+            stub_obj_mark(obj->u.items[i]);
+        }
+    }
+}
+
+static void stub_obj_sweep(mp_embed_ctx_t *ctx) {
+    for (size_t i = 0; i < ctx->n_roots; i++) {
+        stub_obj_mark(ctx->roots[i]);
+    }
+    for (stub_obj_t *obj = ctx->objects; obj; obj = obj->next) {
+        if (obj->pins) {
+            stub_obj_mark(mp_embed_obj_from_ptr(obj));
+        }
+    }
+    stub_obj_t **link = &ctx->objects;
+    while (*link) {
+        stub_obj_t *obj = *link;
+        if (obj->marked) {
+            obj->marked = 0;
+            link = &obj->next;
+        } else {
+            *link = obj->next;
+            stub_gc_free(obj);
+        }
+    }
+}
+
+static void stub_obj_free_all(mp_embed_ctx_t *ctx) {
+    while (ctx->objects) {
+        stub_obj_t *obj = ctx->objects;
+        ctx->objects = obj->next;
+        stub_gc_free(obj);
+    }
+    ctx->roots = NULL;
+    ctx->n_roots = 0;
+}
+
+static int stub_raise(const char *type, const char *message) {
+    mp_embed_ctx_t *ctx = stub_ctx();
+    snprintf(ctx->error, sizeof(ctx->error), "%s: %s", type, message);
+    return MP_EMBED_ERROR;
+}
+
+// A "compiled" module in the stub is just a private copy of its source,
+// or the name and size of a precompiled .mpy image
+struct _mp_embed_compiled_t {
+    mp_embed_ctx_t *ctx;
+    char *source;
+    const char *name;               // Source file name, stored after the source
+    size_t len;
+    size_t mpy_size;
+    void *native_code;              // Machine code of native/viper functions
+    size_t native_size;
+};
+
+// Executable memory: every allocation is its own private mapping, writable
+// while the emitter fills it and read/execute only once committed (W^X)
+typedef struct _stub_exec_chunk_t {
+    struct _stub_exec_chunk_t *next;
+    void *code;
+    size_t size;                    // Mapped bytes
+} stub_exec_chunk_t;
+
+static void stub_free_exec_chunks(mp_embed_ctx_t *ctx) {
+    while (ctx->exec_chunks) {
+        stub_exec_chunk_t *chunk = ctx->exec_chunks;
+        ctx->exec_chunks = chunk->next;
+        munmap(chunk->code, chunk->size);
+        free(chunk);
+    }
+    ctx->exec_used = 0;
+    ctx->exec_total = 0;
+}
+
+static void stub_alloc_exec(mp_embed_ctx_t *ctx, size_t min_size, void **ptr, size_t *size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t map = (min_size + page - 1) / page * page;
+    stub_exec_chunk_t *chunk = malloc(sizeof(*chunk));
+    void *region = chunk && map ? mmap(NULL, map, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
+                                : MAP_FAILED;
+    if (region == MAP_FAILED) {
+        free(chunk);
+        *ptr = NULL;
+        *size = 0;
+        return;
+    }
+    chunk->code = region;
+    chunk->size = map;
+    chunk->next = ctx->exec_chunks;
+    ctx->exec_chunks = chunk;
+    ctx->exec_used += map;
+    ctx->exec_total += map;
+    *ptr = region;
+    *size = map;
+}
+
+static void *stub_commit_exec(void *ptr, size_t size) {
+    if (mprotect(ptr, size, PROT_READ | PROT_EXEC) != 0) {
+        return NULL;
+    }
+    return ptr;
+}
+
+static void stub_free_exec(mp_embed_ctx_t *ctx, void *ptr, size_t size) {
+    for (stub_exec_chunk_t **link = &ctx->exec_chunks; *link; link = &(*link)->next) {
+        stub_exec_chunk_t *chunk = *link;
+        if (chunk->code == ptr) {
+            *link = chunk->next;
+            munmap(chunk->code, chunk->size);
+            ctx->exec_used -= size;
+            ctx->exec_total -= chunk->size;
+            free(chunk);
+            return;
+        }
+    }
+}
+
+// memoryview over host memory; only the object itself is on the heap
+struct _mp_embed_buffer_t {
+    mp_embed_ctx_t *ctx;
+    void *data;
+    size_t len;
+    char typecode;
+    int flags;
+};
+
+#if MICROPYTHON_FROZEN_MODULES
+// Frozen module names: NUL-separated, terminated by an empty name
+extern const char mp_frozen_names[];
+#endif
+
+static int stub_simulate(const char *code, const char *source_name);
+
+static const char *stub_type_name(mp_embed_obj_t obj) {
+    switch (mp_embed_obj_get_type(obj)) {
+        case MP_EMBED_TYPE_NONE: return "NoneType";
+        case MP_EMBED_TYPE_BOOL: return "bool";
+        case MP_EMBED_TYPE_INT: return "int";
+        case MP_EMBED_TYPE_FLOAT: return "float";
+        case MP_EMBED_TYPE_STR: return "str";
+        case MP_EMBED_TYPE_TUPLE: return "tuple";
+        case MP_EMBED_TYPE_LIST: return "list";
+        case MP_EMBED_TYPE_CALLABLE: return "function";
+        default: return "object";
+    }
+}
+
+static int stub_type_error(const char *what, mp_embed_obj_t obj) {
+    char message[96];
+    snprintf(message, sizeof(message), "%s, not '%s'", what, stub_type_name(obj));
+    return stub_raise("TypeError", message);
+}
+
+static int stub_check_args(size_t n_args, size_t min, size_t max) {
+    if (n_args < min || n_args > max) {
+        return stub_raise("TypeError", "function got the wrong number of arguments");
+    }
+    return MP_EMBED_OK;
+}
+
+// Float repr: the shortest form that reads back as the same value
+static int stub_format_float(double value, char *buf, size_t size) {
+    int len = 0;
+    for (int precision = 1; precision <= 17; precision++) {
+        len = snprintf(buf, size, "%.*g", precision, value);
+        if (strtod(buf, NULL) == value) {
+            break;
+        }
+    }
+    if (isfinite(value) && !strpbrk(buf, ".e") && (size_t)len + 2 < size) {
+        memcpy(buf + len, ".0", 3);
+        len += 2;
+    }
+    return len;
+}
+
+// Minimal builtins so lookups and calls can be exercised without a VM
+
+static int stub_builtin_abs(void *data, size_t n_args, const mp_embed_obj_t *args, mp_embed_obj_t *result) {
+    (void)data;
+    long long i;
+    double f;
+    if (stub_check_args(n_args, 1, 1) != MP_EMBED_OK) {
+        return MP_EMBED_ERROR;
+    }
+    if (mp_embed_obj_get_type(args[0]) != MP_EMBED_TYPE_FLOAT && mp_embed_obj_get_int(args[0], &i) == MP_EMBED_OK) {
+        *result = mp_embed_obj_new_int(i < 0 ? -i : i);
+    } else if (mp_embed_obj_get_float(args[0], &f) == MP_EMBED_OK) {
+        *result = mp_embed_obj_new_float(fabs(f));
+    } else {
+        return stub_type_error("bad operand type for abs()", args[0]);
+    }
+    return *result ? MP_EMBED_OK : MP_EMBED_ERROR;
+}
+
+static int stub_builtin_len(void *data, size_t n_args, const mp_embed_obj_t *args, mp_embed_obj_t *result) {
+    (void)data;
+    size_t len;
+    if (stub_check_args(n_args, 1, 1) != MP_EMBED_OK) {
+        return MP_EMBED_ERROR;
+    }
+    if (mp_embed_obj_get_len(args[0], &len) != MP_EMBED_OK) {
+        return stub_type_error("object has no len()", args[0]);
+    }
+    *result = mp_embed_obj_new_int((long long)len);
+    return MP_EMBED_OK;
+}
+
+// Items of the single sequence argument, or the arguments themselves
+static void stub_unpack(size_t *n_args, const mp_embed_obj_t **args) {
+    if (*n_args == 1) {
+        stub_obj_t *seq = stub_obj_ptr((*args)[0]);
+        if (seq && (seq->type == MP_EMBED_TYPE_TUPLE || seq->type == MP_EMBED_TYPE_LIST)) {
+            *n_args = seq->len;
+            *args = seq->u.items;
+        }
+    }
+}
+
+static int stub_minmax(size_t n_args, const mp_embed_obj_t *args, mp_embed_obj_t *result, int sign) {
+    stub_unpack(&n_args, &args);
+    if (n_args == 0) {
+        return stub_raise("ValueError", "arg is an empty sequence");
+    }
+    double best = 0;
+    for (size_t i = 0; i < n_args; i++) {
+        double value;
+        if (mp_embed_obj_get_float(args[i], &value) != MP_EMBED_OK) {
+            return stub_type_error("unsupported type for comparison", args[i]);
+        }
+        if (i == 0 || (value - best) * sign > 0) {
+            best = value;
+            *result = args[i];
+        }
+    }
+    return MP_EMBED_OK;
+}
+
+static int stub_builtin_max(void *data, size_t n_args, const mp_embed_obj_t *args, mp_embed_obj_t *result) {
+    (void)data;
+    return stub_minmax(n_args, args, result, 1);
+}
+
+static int stub_builtin_min(void *data, size_t n_args, const mp_embed_obj_t *args, mp_embed_obj_t *result) {
+    (void)data;
+    return stub_minmax(n_args, args, result, -1);
+}
+
+static int stub_builtin_sum(void *data, size_t n_args, const mp_embed_obj_t *args, mp_embed_obj_t *result) {
+    (void)data;
+    if (stub_check_args(n_args, 1, 1) != MP_EMBED_OK) {
+        return MP_EMBED_ERROR;
+    }
+    stub_obj_t *seq = stub_obj_ptr(args[0]);
+    if (!seq || (seq->type != MP_EMBED_TYPE_TUPLE && seq->type != MP_EMBED_TYPE_LIST)) {
+        return stub_type_error("object isn't iterable", args[0]);
+    }
+    long long isum = 0;
+    double fsum = 0;
+    int is_float = 0;
+    for (size_t i = 0; i < seq->len; i++) {
+        long long ivalue;
+        double fvalue;
+        if (mp_embed_obj_get_type(seq->u.items[i]) == MP_EMBED_TYPE_FLOAT) {
+            is_float = 1;
+        }
+        if (!is_float && mp_embed_obj_get_int(seq->u.items[i], &ivalue) == MP_EMBED_OK) {
+            isum += ivalue;
+        } else if (mp_embed_obj_get_float(seq->u.items[i], &fvalue) == MP_EMBED_OK) {
+            fsum += fvalue;
+        } else {
+            return stub_type_error("unsupported type for +", seq->u.items[i]);
+        }
+    }
+    *result = is_float ? mp_embed_obj_new_float(fsum + (double)isum) : mp_embed_obj_new_int(isum);
+    return *result ? MP_EMBED_OK : MP_EMBED_ERROR;
+}
+
+static int stub_builtin_str(void *data, size_t n_args, const mp_embed_obj_t *args, mp_embed_obj_t *result) {
+    (void)data;
+    char buf[32];
+    long long i;
+    double f;
+    if (stub_check_args(n_args, 1, 1) != MP_EMBED_OK) {
+        return MP_EMBED_ERROR;
+    }
+    switch (mp_embed_obj_get_type(args[0])) {
+        case MP_EMBED_TYPE_STR:
+            *result = args[0];
+            return MP_EMBED_OK;
+        case MP_EMBED_TYPE_NONE:
+            snprintf(buf, sizeof(buf), "None");
+            break;
+        case MP_EMBED_TYPE_BOOL:
+            snprintf(buf, sizeof(buf), "%s", args[0] == MP_EMBED_OBJ_TRUE ? "True" : "False");
+            break;
+        case MP_EMBED_TYPE_INT:
+            mp_embed_obj_get_int(args[0], &i);
+            snprintf(buf, sizeof(buf), "%lld", i);
+            break;
+        case MP_EMBED_TYPE_FLOAT:
+            mp_embed_obj_get_float(args[0], &f);
+            stub_format_float(f, buf, sizeof(buf));
+            break;
+        default:
+            snprintf(buf, sizeof(buf), "<%s>", stub_type_name(args[0]));
+            break;
+    }
+    *result = mp_embed_obj_new_str(buf, strlen(buf));
+    return *result ? MP_EMBED_OK : MP_EMBED_ERROR;
+}
+
+static int stub_builtin_int(void *data, size_t n_args, const mp_embed_obj_t *args, mp_embed_obj_t *result) {
+    (void)data;
+    long long i;
+    double f;
+    const char *str;
+    size_t len;
+    if (stub_check_args(n_args, 1, 1) != MP_EMBED_OK) {
+        return MP_EMBED_ERROR;
+    }
+    if (mp_embed_obj_get_type(args[0]) == MP_EMBED_TYPE_FLOAT) {
+        mp_embed_obj_get_float(args[0], &f);
+        if (!isfinite(f)) {
+            return stub_raise("OverflowError", "can't convert float to int");
+        }
+        *result = mp_embed_obj_new_int((long long)f);
+    } else if (mp_embed_obj_get_int(args[0], &i) == MP_EMBED_OK) {
+        *result = mp_embed_obj_new_int(i);
+    } else if (mp_embed_obj_get_str(args[0], &str, &len) == MP_EMBED_OK) {
+        char *end;
+        i = strtoll(str, &end, 10);
+        while (*end == ' ' || *end == '\n') {
+            end++;
+        }
+        if (len == 0 || end != str + len) {
+            return stub_raise("ValueError", "invalid syntax for integer");
+        }
+        *result = mp_embed_obj_new_int(i);
+    } else {
+        return stub_type_error("can't convert to int", args[0]);
+    }
+    return *result ? MP_EMBED_OK : MP_EMBED_ERROR;
+}
+
+static int stub_builtin_float(void *data, size_t n_args, const mp_embed_obj_t *args, mp_embed_obj_t *result) {
+    (void)data;
+    double f;
+    const char *str;
+    size_t len;
+    if (stub_check_args(n_args, 1, 1) != MP_EMBED_OK) {
+        return MP_EMBED_ERROR;
+    }
+    if (mp_embed_obj_get_float(args[0], &f) == MP_EMBED_OK) {
+        *result = mp_embed_obj_new_float(f);
+    } else if (mp_embed_obj_get_str(args[0], &str, &len) == MP_EMBED_OK) {
+        char *end;
+        f = strtod(str, &end);
+        if (len == 0 || end != str + len) {
+            return stub_raise("ValueError", "invalid syntax for number");
+        }
+        *result = mp_embed_obj_new_float(f);
+    } else {
+        return stub_type_error("can't convert to float", args[0]);
+    }
+    return *result ? MP_EMBED_OK : MP_EMBED_ERROR;
+}
+
+static int stub_math_sqrt(void *data, size_t n_args, const mp_embed_obj_t *args, mp_embed_obj_t *result) {
+    (void)data;
+    double f;
+    if (stub_check_args(n_args, 1, 1) != MP_EMBED_OK) {
+        return MP_EMBED_ERROR;
+    }
+    if (mp_embed_obj_get_float(args[0], &f) != MP_EMBED_OK) {
+        return stub_type_error("can't convert to float", args[0]);
+    }
+    if (f < 0) {
+        return stub_raise("ValueError", "math domain error");
+    }
+    *result = mp_embed_obj_new_float(sqrt(f));
+    return *result ? MP_EMBED_OK : MP_EMBED_ERROR;
+}
+
+static int stub_math_floor(void *data, size_t n_args, const mp_embed_obj_t *args, mp_embed_obj_t *result) {
+    (void)data;
+    double f;
+    if (stub_check_args(n_args, 1, 1) != MP_EMBED_OK) {
+        return MP_EMBED_ERROR;
+    }
+    if (mp_embed_obj_get_float(args[0], &f) != MP_EMBED_OK) {
+        return stub_type_error("can't convert to float", args[0]);
+    }
+    if (!isfinite(f)) {
+        return stub_raise("OverflowError", "can't convert float to int");
+    }
+    *result = mp_embed_obj_new_int((long long)floor(f));
+    return *result ? MP_EMBED_OK : MP_EMBED_ERROR;
+}
+
+#define STUB_FUN(fn_, name_) { NULL, MP_EMBED_TYPE_CALLABLE, 0, 0, 0, 0, { .fun = { fn_, NULL, name_ } } }
+
+static stub_obj_t stub_builtins[] = {
+    STUB_FUN(stub_builtin_abs, "abs"),
+    STUB_FUN(stub_builtin_float, "float"),
+    STUB_FUN(stub_builtin_int, "int"),
+    STUB_FUN(stub_builtin_len, "len"),
+    STUB_FUN(stub_builtin_max, "max"),
+    STUB_FUN(stub_builtin_min, "min"),
+    STUB_FUN(stub_builtin_str, "str"),
+    STUB_FUN(stub_builtin_sum, "sum"),
+};
+
+static stub_obj_t stub_math[] = {
+    STUB_FUN(stub_math_floor, "floor"),
+    STUB_FUN(stub_math_sqrt, "sqrt"),
+};
+
+typedef struct _stub_module_t {
+    const char *name;
+    stub_obj_t *attrs;
+    size_t n_attrs;
+} stub_module_t;
+
+static const stub_module_t stub_modules[] = {
+    { "builtins", stub_builtins, sizeof(stub_builtins) / sizeof(stub_builtins[0]) },
+    { "math", stub_math, sizeof(stub_math) / sizeof(stub_math[0]) },
+};
+
+static stub_module_t *stub_find_native_module(const char *name, size_t len) {
+    mp_embed_ctx_t *ctx = stub_ctx();
+    for (size_t i = 0; i < ctx->n_native_modules; i++) {
+        stub_module_t *module = &ctx->native_modules[i];
+        if (strlen(module->name) == len && strncmp(module->name, name, len) == 0) {
+            return module;
+        }
+    }
+    return NULL;
+}
+
+static const stub_module_t *stub_find_module(const char *name, size_t len) {
+    for (size_t i = 0; i < sizeof(stub_modules) / sizeof(stub_modules[0]); i++) {
+        if (strlen(stub_modules[i].name) == len && strncmp(stub_modules[i].name, name, len) == 0) {
+            return &stub_modules[i];
+        }
+    }
+    return stub_find_native_module(name, len);
+}
+
+static void stub_free_module(stub_module_t *module) {
+    for (size_t i = 0; i < module->n_attrs; i++) {
+        free((char *)module->attrs[i].u.fun.name);
+    }
+    free(module->attrs);
+    free((char *)module->name);
+}
+
+static void stub_free_native_modules(mp_embed_ctx_t *ctx) {
+    for (size_t i = 0; i < ctx->n_native_modules; i++) {
+        stub_free_module(&ctx->native_modules[i]);
+    }
+    free(ctx->native_modules);
+    ctx->native_modules = NULL;
+    ctx->n_native_modules = 0;
+}
+
+typedef struct _stub_script_module_t {
+    char *name;
+    unsigned int generation;        // Times the module was (re)loaded
+} stub_script_module_t;
+
+static stub_script_module_t *stub_find_script_module(const char *name, size_t len) {
+    mp_embed_ctx_t *ctx = stub_ctx();
+    for (size_t i = 0; i < ctx->n_script_modules; i++) {
+        stub_script_module_t *module = &ctx->script_modules[i];
+        if (strlen(module->name) == len && strncmp(module->name, name, len) == 0) {
+            return module;
+        }
+    }
+    return NULL;
+}
+
+static void stub_free_script_modules(mp_embed_ctx_t *ctx) {
+    for (size_t i = 0; i < ctx->n_script_modules; i++) {
+        free(ctx->script_modules[i].name);
+    }
+    free(ctx->script_modules);
+    ctx->script_modules = NULL;
+    ctx->n_script_modules = 0;
+}
+
+static stub_obj_t *stub_find_attr(const stub_module_t *module, const char *name, size_t len) {
+    for (size_t i = 0; i < module->n_attrs; i++) {
+        const char *attr = module->attrs[i].u.fun.name;
+        if (strlen(attr) == len && strncmp(attr, name, len) == 0) {
+            return &module->attrs[i];
+        }
+    }
+    return NULL;
+}
+
+// Report whether an imported module would be served from sys.modules or
+// the native or frozen module tables
+static void stub_simulate_import(const char *code) {
+    const char *start = strstr(code, "import ") + 7;
+    size_t len = strcspn(start, " \t\r\n,");
+    const stub_script_module_t *loaded = stub_find_script_module(start, len);
+    if (loaded) {
+        stub_trace("MicroPython stub: import %s resolved from sys.modules (load %u)\n",
+                   loaded->name, loaded->generation);
+        return;
+    }
+    const stub_module_t *module = stub_find_native_module(start, len);
+    if (module) {
+        stub_trace("MicroPython stub: import %s resolved from native modules\n", module->name);
+        return;
+    }
+#if MICROPYTHON_FROZEN_MODULES
+    for (const char *name = mp_frozen_names; *name; name += strlen(name) + 1) {
+        if (strncmp(name, start, len) == 0 && strcmp(name + len, ".py") == 0) {
+            stub_trace("MicroPython stub: import %s resolved from frozen modules\n", name);
+            return;
+        }
+    }
+#endif
+    stub_trace("MicroPython stub: import statement detected\n");
+}
 
 // Stub implementations of MicroPython API functions
 
+mp_embed_ctx_t *mp_embed_ctx_new(size_t stack_limit) {
+    mp_embed_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    if (ctx) {
+        ctx->stack_limit = stack_limit;
+    }
+    return ctx;
+}
+
+void mp_embed_ctx_free(mp_embed_ctx_t *ctx) {
+    if (ctx && ctx != &default_ctx) {
+        free(ctx);
+    }
+}
+
+mp_embed_ctx_t *mp_embed_ctx_enter(mp_embed_ctx_t *ctx, void *stack_top) {
+    mp_embed_ctx_t *previous = current_ctx;
+    current_ctx = ctx;
+    // A real port calls mp_stack_set_top()/mp_stack_set_limit() here
+    if (ctx && ctx != previous) {
+        ctx->stack_top = stack_top;
+    }
+    return previous;
+}
+
+void mp_embed_ctx_leave(mp_embed_ctx_t *previous) {
+    current_ctx = previous;
+}
+
+void mp_embed_ctx_set_output(mp_embed_ctx_t *ctx, mp_embed_write_fn_t print_fn, mp_embed_write_fn_t trace_fn, void *data) {
+    ctx->print_fn = print_fn;
+    ctx->trace_fn = trace_fn;
+    ctx->output_data = data;
+}
+
+void mp_embed_ctx_set_profiler(mp_embed_ctx_t *ctx, mp_embed_sample_fn_t sample_fn, void *data) {
+    ctx->sample_fn = sample_fn;
+    ctx->sample_data = data;
+}
+
+void mp_embed_profile_request(mp_embed_ctx_t *ctx) {
+    atomic_store(&ctx->profile_pending, 1);
+}
+
+void mp_embed_interrupt(mp_embed_ctx_t *ctx) {
+    atomic_store(&(ctx ? ctx : &default_ctx)->interrupt_pending, 1);
+}
+
+void mp_embed_clear_interrupt(void) {
+    atomic_store(&stub_ctx()->interrupt_pending, 0);
+}
+
 int mp_embed_init(void *heap, size_t heap_size, void *stack_top) {
-    printf("MicroPython stub: mp_embed_init called with heap_size=%zu\n", heap_size);
+    mp_embed_ctx_t *ctx = stub_ctx();
+    ctx->heap = heap;
+    ctx->heap_size = heap_size;
+    ctx->stack_top = stack_top;
+    ctx->initialized = 1;
+    ctx->gc_auto = 1;
+    ctx->gc_threshold = 0;
+    stub_trace("MicroPython stub: mp_embed_init called with heap_size=%zu\n", heap_size);
     return 0;
 }
 
 void mp_embed_deinit(void) {
-    printf("MicroPython stub: mp_embed_deinit called\n");
+    mp_embed_ctx_t *ctx = stub_ctx();
+    stub_obj_free_all(ctx);
+    stub_free_native_modules(ctx);
+    stub_free_script_modules(ctx);
+    stub_free_exec_chunks(ctx);
+    ctx->emitter = MP_EMBED_EMIT_BYTECODE;
+    ctx->initialized = 0;
+    ctx->heap = NULL;
+    ctx->heap_size = 0;
+    ctx->blocks_used = 0;
+    ctx->num_1block = 0;
+    ctx->num_2block = 0;
+    ctx->max_block = 0;
+    ctx->alloc_since_gc = 0;
+    stub_trace("MicroPython stub: mp_embed_deinit called\n");
+}
+
+int mp_embed_reset(void) {
+    mp_embed_ctx_t *ctx = stub_ctx();
+    if (!ctx->initialized) {
+        return MP_EMBED_ERROR;
+    }
+    // Everything on the heap is garbage after a soft reset, and the module
+    // table is back to the built-in modules
+    stub_obj_free_all(ctx);
+    stub_free_native_modules(ctx);
+    stub_free_script_modules(ctx);
+    stub_free_exec_chunks(ctx);
+    ctx->emitter = MP_EMBED_EMIT_BYTECODE;
+    ctx->blocks_used = 0;
+    ctx->num_1block = 0;
+    ctx->num_2block = 0;
+    ctx->max_block = 0;
+    ctx->alloc_since_gc = 0;
+    ctx->gc_auto = 1;
+    ctx->gc_threshold = 0;
+    ctx->quota_active = 0;
+    atomic_store(&ctx->interrupt_pending, 0);
+    return MP_EMBED_OK;
 }
 
 int mp_embed_exec_str(const char *code) {
-    printf("MicroPython stub: executing code:\n%s\n", code);
+    if (!stub_ctx()->initialized) {
+        return MP_EMBED_ERROR;
+    }
+    return stub_simulate(code, "<stdin>");
+}
+
+void mp_embed_heap_info(mp_embed_heap_info_t *info) {
+    mp_embed_ctx_t *ctx = stub_ctx();
+    size_t used = ctx->blocks_used * STUB_GC_BLOCK_SIZE;
+    info->total = ctx->heap_size;
+    info->used = used;
+    info->free = ctx->heap_size > used ? ctx->heap_size - used : 0;
+    info->max_free = info->free;
+    info->block_size = STUB_GC_BLOCK_SIZE;
+    info->num_1block = ctx->num_1block;
+    info->num_2block = ctx->num_2block;
+    info->max_block = ctx->max_block * STUB_GC_BLOCK_SIZE;
+    info->alloc_since_gc = ctx->alloc_since_gc;
+    info->allocations = ctx->allocations;
+    info->collections = ctx->collections;
+    info->gc_time_us = ctx->gc_time_us;
+    info->exec_used = ctx->exec_used;
+    info->exec_total = ctx->exec_total;
+}
+
+void mp_embed_gc_collect(void) {
+    stub_gc_collect(stub_ctx());
+}
+
+int mp_embed_gc_set_auto(int enabled) {
+    mp_embed_ctx_t *ctx = stub_ctx();
+    int previous = ctx->gc_auto;
+    ctx->gc_auto = enabled;
+    return previous;
+}
+
+void mp_embed_quota_begin(size_t max_alloc, size_t max_live) {
+    mp_embed_ctx_t *ctx = stub_ctx();
+    ctx->quota_active = 1;
+    ctx->quota_max_alloc = max_alloc;
+    ctx->quota_max_live = max_live;
+    ctx->quota_live_base = ctx->blocks_used * STUB_GC_BLOCK_SIZE;
+    memset(&ctx->quota, 0, sizeof(ctx->quota));
+}
+
+void mp_embed_quota_usage(mp_embed_quota_usage_t *usage) {
+    *usage = stub_ctx()->quota;
+}
+
+void mp_embed_quota_end(void) {
+    stub_ctx()->quota_active = 0;
+}
+
+void mp_embed_gc_set_threshold(size_t bytes) {
+    stub_ctx()->gc_threshold = bytes;
+}
+
+mp_embed_buffer_t *mp_embed_buffer_new(const char *name, void *data, size_t len, char typecode, int flags) {
+    if (!stub_ctx()->initialized || !name || !*name || (!data && len)) {
+        return NULL;
+    }
+    if (!strchr("bBhHiIqQfd", typecode)) {
+        return NULL;
+    }
+    mp_embed_buffer_t *buffer = stub_gc_alloc(sizeof(*buffer));
+    if (!buffer) {
+        return NULL;
+    }
+    buffer->ctx = stub_ctx();
+    buffer->data = data;
+    buffer->len = len;
+    buffer->typecode = typecode;
+    buffer->flags = flags;
+    stub_trace("MicroPython stub: %s = memoryview('%c', %zu bytes%s)\n", name, typecode, len,
+           flags & MP_EMBED_BUFFER_WRITABLE ? "" : ", read-only");
+    return buffer;
+}
+
+void mp_embed_buffer_release(mp_embed_buffer_t *buffer) {
+    if (buffer) {
+        buffer->data = NULL;
+        buffer->len = 0;
+        stub_gc_free(buffer);
+    }
+}
+
+mp_embed_obj_t mp_embed_obj_new_int(long long value) {
+    if (mp_embed_small_int_fits(value)) {
+        return mp_embed_obj_from_small_int((mp_embed_small_int_t)value);
+    }
+    stub_obj_t *obj = stub_obj_alloc(MP_EMBED_TYPE_INT, 0);
+    if (!obj) {
+        return MP_EMBED_OBJ_NULL;
+    }
+    obj->u.i = value;
+    return mp_embed_obj_from_ptr(obj);
+}
+
+mp_embed_obj_t mp_embed_obj_new_float(double value) {
+#if MP_EMBED_NAN_BOXING
+    return mp_embed_obj_from_float(value);
+#else
+    // MICROPY_OBJ_REPR_A boxes every float on the heap
+    stub_obj_t *obj = stub_obj_alloc(MP_EMBED_TYPE_FLOAT, 0);
+    if (!obj) {
+        return MP_EMBED_OBJ_NULL;
+    }
+    obj->u.f = value;
+    return mp_embed_obj_from_ptr(obj);
+#endif
+}
+
+mp_embed_obj_t mp_embed_obj_new_str(const char *data, size_t len) {
+    stub_obj_t *obj = stub_obj_alloc(MP_EMBED_TYPE_STR, len + 1);
+    if (!obj) {
+        return MP_EMBED_OBJ_NULL;
+    }
+    obj->u.s = (char *)(obj + 1);
+    memcpy(obj->u.s, data, len);
+    obj->u.s[len] = '\0';
+    obj->len = len;
+    return mp_embed_obj_from_ptr(obj);
+}
+
+static mp_embed_obj_t stub_new_seq(int type, size_t len) {
+    stub_obj_t *obj = stub_obj_alloc(type, len * sizeof(mp_embed_obj_t));
+    if (!obj) {
+        return MP_EMBED_OBJ_NULL;
+    }
+    obj->u.items = (mp_embed_obj_t *)(obj + 1);
+    for (size_t i = 0; i < len; i++) {
+        obj->u.items[i] = MP_EMBED_OBJ_NONE;
+    }
+    obj->len = len;
+    return mp_embed_obj_from_ptr(obj);
+}
+
+mp_embed_obj_t mp_embed_obj_new_tuple(size_t len) {
+    return stub_new_seq(MP_EMBED_TYPE_TUPLE, len);
+}
+
+mp_embed_obj_t mp_embed_obj_new_list(size_t len) {
+    return stub_new_seq(MP_EMBED_TYPE_LIST, len);
+}
+
+void mp_embed_obj_set_item(mp_embed_obj_t seq, size_t index, mp_embed_obj_t item) {
+    stub_obj_t *obj = stub_obj_ptr(seq);
+    if (obj && (obj->type == MP_EMBED_TYPE_TUPLE || obj->type == MP_EMBED_TYPE_LIST) && index < obj->len) {
+        obj->u.items[index] = item;
+    }
+}
+
+int mp_embed_obj_get_type(mp_embed_obj_t obj) {
+    if (mp_embed_obj_is_small_int(obj)) {
+        return MP_EMBED_TYPE_INT;
+    }
+    if (obj == MP_EMBED_OBJ_NONE) {
+        return MP_EMBED_TYPE_NONE;
+    }
+    if (mp_embed_obj_is_bool(obj)) {
+        return MP_EMBED_TYPE_BOOL;
+    }
+    if (mp_embed_obj_is_float(obj)) {
+        return MP_EMBED_TYPE_FLOAT;
+    }
+    stub_obj_t *ptr = stub_obj_ptr(obj);
+    return ptr ? ptr->type : MP_EMBED_TYPE_OTHER;
+}
+
+int mp_embed_obj_get_int(mp_embed_obj_t obj, long long *value) {
+    if (mp_embed_obj_is_small_int(obj)) {
+        *value = mp_embed_obj_small_int_value(obj);
+        return MP_EMBED_OK;
+    }
+    if (mp_embed_obj_is_bool(obj)) {
+        *value = obj == MP_EMBED_OBJ_TRUE;
+        return MP_EMBED_OK;
+    }
+    stub_obj_t *ptr = stub_obj_ptr(obj);
+    if (ptr && ptr->type == MP_EMBED_TYPE_INT) {
+        *value = ptr->u.i;
+        return MP_EMBED_OK;
+    }
+    return MP_EMBED_ERROR;
+}
+
+int mp_embed_obj_get_float(mp_embed_obj_t obj, double *value) {
+    long long i;
+    if (mp_embed_obj_get_int(obj, &i) == MP_EMBED_OK) {
+        *value = (double)i;
+        return MP_EMBED_OK;
+    }
+#if MP_EMBED_NAN_BOXING
+    if (mp_embed_obj_is_float(obj)) {
+        *value = mp_embed_obj_float_value(obj);
+        return MP_EMBED_OK;
+    }
+#endif
+    stub_obj_t *ptr = stub_obj_ptr(obj);
+    if (ptr && ptr->type == MP_EMBED_TYPE_FLOAT) {
+        *value = ptr->u.f;
+        return MP_EMBED_OK;
+    }
+    return MP_EMBED_ERROR;
+}
+
+int mp_embed_obj_get_str(mp_embed_obj_t obj, const char **data, size_t *len) {
+    stub_obj_t *ptr = stub_obj_ptr(obj);
+    if (!ptr || ptr->type != MP_EMBED_TYPE_STR) {
+        return MP_EMBED_ERROR;
+    }
+    *data = ptr->u.s;
+    *len = ptr->len;
+    return MP_EMBED_OK;
+}
+
+int mp_embed_obj_get_len(mp_embed_obj_t obj, size_t *len) {
+    stub_obj_t *ptr = stub_obj_ptr(obj);
+    if (!ptr || (ptr->type != MP_EMBED_TYPE_STR && ptr->type != MP_EMBED_TYPE_TUPLE &&
+                 ptr->type != MP_EMBED_TYPE_LIST)) {
+        return MP_EMBED_ERROR;
+    }
+    *len = ptr->len;
+    return MP_EMBED_OK;
+}
+
+mp_embed_obj_t mp_embed_obj_get_item(mp_embed_obj_t seq, size_t index) {
+    stub_obj_t *ptr = stub_obj_ptr(seq);
+    if (!ptr || (ptr->type != MP_EMBED_TYPE_TUPLE && ptr->type != MP_EMBED_TYPE_LIST) || index >= ptr->len) {
+        return MP_EMBED_OBJ_NULL;
+    }
+    return ptr->u.items[index];
+}
+
+void mp_embed_set_roots(mp_embed_obj_t *roots, size_t count) {
+    mp_embed_ctx_t *ctx = stub_ctx();
+    ctx->roots = roots;
+    ctx->n_roots = count;
+}
+
+void mp_embed_obj_pin(mp_embed_obj_t obj) {
+    stub_obj_t *ptr = stub_obj_ptr(obj);
+    if (ptr && ptr->on_heap) {
+        ptr->pins++;
+    }
+}
+
+void mp_embed_obj_unpin(mp_embed_obj_t obj) {
+    stub_obj_t *ptr = stub_obj_ptr(obj);
+    if (ptr && ptr->on_heap && ptr->pins) {
+        ptr->pins--;
+    }
+}
+
+mp_embed_obj_t mp_embed_lookup(const char *name, size_t len) {
+    char message[96];
+    if (!stub_ctx()->initialized) {
+        stub_raise("RuntimeError", "VM not initialized");
+        return MP_EMBED_OBJ_NULL;
+    }
+    const char *dot = memchr(name, '.', len);
+    const char *last = dot;
+    while (last && (size_t)(last - name) < len) {
+        const char *next = memchr(last + 1, '.', len - (size_t)(last + 1 - name));
+        if (!next) {
+            break;
+        }
+        last = next;
+    }
+    stub_obj_t *fun = NULL;
+    if (!last) {
+        // The stub has no __main__ globals, only builtins
+        fun = stub_find_attr(stub_find_module("builtins", 8), name, len);
+        if (!fun) {
+            snprintf(message, sizeof(message), "name '%.*s' isn't defined", (int)len, name);
+            stub_raise("NameError", message);
+            return MP_EMBED_OBJ_NULL;
+        }
+    } else {
+        size_t module_len = (size_t)(last - name);
+        const stub_module_t *module = stub_find_module(name, module_len);
+        if (!module) {
+            snprintf(message, sizeof(message), "no module named '%.*s'", (int)module_len, name);
+            stub_raise("ImportError", message);
+            return MP_EMBED_OBJ_NULL;
+        }
+        fun = stub_find_attr(module, last + 1, len - module_len - 1);
+        if (!fun) {
+            snprintf(message, sizeof(message), "'module' object has no attribute '%.*s'",
+                     (int)(len - module_len - 1), last + 1);
+            stub_raise("AttributeError", message);
+            return MP_EMBED_OBJ_NULL;
+        }
+    }
+    mp_embed_obj_pin(mp_embed_obj_from_ptr(fun));
+    return mp_embed_obj_from_ptr(fun);
+}
+
+int mp_embed_call(mp_embed_obj_t fun, size_t n_args, const mp_embed_obj_t *args, mp_embed_obj_t *result) {
+    mp_embed_ctx_t *ctx = stub_ctx();
+    *result = MP_EMBED_OBJ_NONE;
+    if (!ctx->initialized) {
+        return stub_raise("RuntimeError", "VM not initialized");
+    }
+    stub_obj_t *callable = stub_obj_ptr(fun);
+    if (!callable || callable->type != MP_EMBED_TYPE_CALLABLE) {
+        char message[64];
+        snprintf(message, sizeof(message), "'%s' object isn't callable", stub_type_name(fun));
+        return stub_raise("TypeError", message);
+    }
+    if (atomic_exchange(&ctx->interrupt_pending, 0)) {
+        stub_raise("KeyboardInterrupt", "");
+        return MP_EMBED_INTERRUPTED;
+    }
+    ctx->error[0] = '\0';
+    int rc = callable->u.fun.fn(callable->u.fun.data, n_args, args, result);
+    if (rc != MP_EMBED_OK) {
+        *result = MP_EMBED_OBJ_NULL;
+        return rc;
+    }
+    if (*result == MP_EMBED_OBJ_NULL) {
+        *result = MP_EMBED_OBJ_NONE;
+    }
+    return MP_EMBED_OK;
+}
+
+const char *mp_embed_error_message(void) {
+    return stub_ctx()->error;
+}
+
+int mp_embed_register_module(const char *name, const mp_embed_native_fun_t *funs, size_t n_funs) {
+    mp_embed_ctx_t *ctx = stub_ctx();
+    if (!ctx->initialized) {
+        return MP_EMBED_ERROR;
+    }
+    stub_module_t module = { strdup(name), calloc(n_funs ? n_funs : 1, sizeof(stub_obj_t)), n_funs };
+    if (!module.name || !module.attrs) {
+        module.n_attrs = 0;
+        stub_free_module(&module);
+        return MP_EMBED_ERROR;
+    }
+    for (size_t i = 0; i < n_funs; i++) {
+        stub_obj_t *fun = &module.attrs[i];
+        fun->type = MP_EMBED_TYPE_CALLABLE;
+        fun->u.fun.fn = funs[i].fn;
+        fun->u.fun.data = funs[i].data;
+        fun->u.fun.name = strdup(funs[i].name);
+        if (!fun->u.fun.name) {
+            stub_free_module(&module);
+            return MP_EMBED_ERROR;
+        }
+    }
+    
+    // Replace an earlier registration of the same name
+    stub_module_t *existing = stub_find_native_module(name, strlen(name));
+    if (existing) {
+        stub_free_module(existing);
+        *existing = module;
+        return MP_EMBED_OK;
+    }
+    stub_module_t *modules = realloc(ctx->native_modules, (ctx->n_native_modules + 1) * sizeof(*modules));
+    if (!modules) {
+        stub_free_module(&module);
+        return MP_EMBED_ERROR;
+    }
+    modules[ctx->n_native_modules++] = module;
+    ctx->native_modules = modules;
+    return MP_EMBED_OK;
+}
+
+int mp_embed_raise(const char *type, const char *message) {
+    return stub_raise(type, message);
+}
+
+const char *mp_embed_build_id(void) {
+    return "micropython-embed-stub " __DATE__ " " __TIME__;
+}
+
+size_t mp_embed_snapshot_state_size(void) {
+    return sizeof(stub_snapshot_state_t);
+}
+
+int mp_embed_snapshot_save(void *state, size_t len) {
+    mp_embed_ctx_t *ctx = stub_ctx();
+    if (!ctx->initialized || len < sizeof(stub_snapshot_state_t)) {
+        return MP_EMBED_ERROR;
+    }
+    if (ctx->exec_used) {
+        // Function objects would point into the code arena, which the image lacks
+        snprintf(ctx->error, sizeof(ctx->error), "RuntimeError: native code cannot be snapshotted");
+        return MP_EMBED_ERROR;
+    }
+    stub_snapshot_state_t saved;
+    memset(&saved, 0, sizeof(saved));
+    saved.magic = STUB_SNAPSHOT_MAGIC;
+    saved.heap_size = ctx->heap_size;
+    saved.blocks_used = ctx->blocks_used;
+    saved.num_1block = ctx->num_1block;
+    saved.num_2block = ctx->num_2block;
+    saved.max_block = ctx->max_block;
+    saved.alloc_since_gc = ctx->alloc_since_gc;
+    saved.gc_auto = ctx->gc_auto;
+    saved.gc_threshold = ctx->gc_threshold;
+    memcpy(state, &saved, sizeof(saved));
+    return MP_EMBED_OK;
+}
+
+int mp_embed_snapshot_restore(void *heap, size_t heap_size, const void *state, size_t len, void *stack_top) {
+    mp_embed_ctx_t *ctx = stub_ctx();
+    stub_snapshot_state_t saved;
+    if (len < sizeof(saved)) {
+        return MP_EMBED_ERROR;
+    }
+    memcpy(&saved, state, sizeof(saved));
+    if (saved.magic != STUB_SNAPSHOT_MAGIC || saved.heap_size != heap_size) {
+        return MP_EMBED_ERROR;
+    }
+    ctx->heap = heap;
+    ctx->heap_size = heap_size;
+    ctx->stack_top = stack_top;
+    ctx->blocks_used = saved.blocks_used;
+    ctx->num_1block = saved.num_1block;
+    ctx->num_2block = saved.num_2block;
+    ctx->max_block = saved.max_block;
+    ctx->alloc_since_gc = saved.alloc_since_gc;
+    ctx->gc_auto = saved.gc_auto;
+    ctx->gc_threshold = saved.gc_threshold;
+    ctx->objects = NULL;    // Stub objects live outside the heap image
+    ctx->roots = NULL;
+    ctx->n_roots = 0;
+    stub_free_native_modules(ctx);
+    stub_free_script_modules(ctx);
+    stub_free_exec_chunks(ctx);
+    ctx->emitter = MP_EMBED_EMIT_BYTECODE;
+    ctx->initialized = 1;
+    return MP_EMBED_OK;
+}
+
+// Whether compiling this code runs the native or viper emitter
+static int stub_emits_native(mp_embed_ctx_t *ctx, const char *code) {
+#if MICROPY_EMIT_X64
+    return ctx->emitter != MP_EMBED_EMIT_BYTECODE ||
+           strstr(code, "@micropython.native") || strstr(code, "@micropython.viper");
+#else
+    (void)ctx;
+    (void)code;
+    return 0;
+#endif
+}
+
+int mp_embed_set_emitter(int emitter) {
+#if MICROPY_EMIT_X64
+    if (emitter < MP_EMBED_EMIT_BYTECODE || emitter > MP_EMBED_EMIT_VIPER) {
+        return MP_EMBED_ERROR;
+    }
+#else
+    if (emitter != MP_EMBED_EMIT_BYTECODE) {
+        return MP_EMBED_ERROR;
+    }
+#endif
+    stub_ctx()->emitter = emitter;
+    return MP_EMBED_OK;
+}
+
+void mp_embed_alloc_exec(size_t min_size, void **ptr, size_t *size) {
+    stub_alloc_exec(stub_ctx(), min_size, ptr, size);
+}
+
+void *mp_embed_commit_exec(void *ptr, size_t size, void *reloc) {
+    (void)reloc;
+    return stub_commit_exec(ptr, size);
+}
+
+void mp_embed_free_exec(void *ptr, size_t size) {
+    stub_free_exec(stub_ctx(), ptr, size);
+}
+
+mp_embed_compiled_t *mp_embed_compile_str(const char *code, size_t len, const char *source_name) {
+    if (!stub_ctx()->initialized) {
+        return NULL;
+    }
+    mp_embed_compiled_t *compiled = stub_gc_alloc(sizeof(*compiled));
+    if (!compiled) {
+        return NULL;
+    }
+    size_t name_len = strlen(source_name);
+    compiled->source = stub_gc_alloc(len + 1 + name_len + 1);
+    if (!compiled->source) {
+        stub_gc_free(compiled);
+        return NULL;
+    }
+    memcpy(compiled->source, code, len);
+    compiled->source[len] = '\0';
+    compiled->name = memcpy(compiled->source + len + 1, source_name, name_len + 1);
+    compiled->ctx = stub_ctx();
+    compiled->len = len;
+    compiled->mpy_size = 0;
+    compiled->native_code = NULL;
+    compiled->native_size = 0;
+    if (stub_emits_native(compiled->ctx, compiled->source)) {
+        // Machine code is roughly four times the size of the bytecode
+        stub_alloc_exec(compiled->ctx, 4 * len, &compiled->native_code, &compiled->native_size);
+        if (!compiled->native_code) {
+            stub_gc_free(compiled->source);
+            stub_gc_free(compiled);
+            return NULL;
+        }
+        // Simulated emitter: the stub reserves and commits the code area a
+        // real emitter would fill, but emits and runs no machine code
+        memset(compiled->native_code, 0xcc, compiled->native_size);
+        if (!stub_commit_exec(compiled->native_code, compiled->native_size)) {
+            stub_free_exec(compiled->ctx, compiled->native_code, compiled->native_size);
+            stub_gc_free(compiled->source);
+            stub_gc_free(compiled);
+            return NULL;
+        }
+        stub_trace("MicroPython stub: reserved %zu bytes of (simulated) native code for %s\n",
+                   compiled->native_size, source_name);
+    }
+    return compiled;
+}
+
+mp_embed_compiled_t *mp_embed_load_mpy(const unsigned char *data, size_t len, const char *source_name) {
+    if (!data || len < STUB_MPY_HEADER_SIZE || data[0] != 'M' || data[1] != STUB_MPY_VERSION) {
+        stub_trace("MicroPython stub: invalid .mpy data for %s\n", source_name);
+        return NULL;
+    }
+    mp_embed_compiled_t *compiled = mp_embed_compile_str(source_name, strlen(source_name), source_name);
+    if (compiled) {
+        if (compiled->native_code) {
+            // The module's machine code, if any, comes with the .mpy data
+            stub_free_exec(compiled->ctx, compiled->native_code, compiled->native_size);
+            compiled->native_code = NULL;
+            compiled->native_size = 0;
+        }
+        compiled->mpy_size = len;
+    }
+    return compiled;
+}
+
+int mp_embed_exec_compiled(mp_embed_compiled_t *compiled) {
+    if (!compiled || compiled->ctx != stub_ctx() || !compiled->ctx->initialized) {
+        return MP_EMBED_ERROR;
+    }
+    if (compiled->mpy_size) {
+        stub_trace("MicroPython stub: executing precompiled module %s (%zu bytes)\n",
+               compiled->source, compiled->mpy_size);
+        return MP_EMBED_OK;
+    }
+    if (compiled->native_code) {
+        stub_trace("MicroPython stub: running %zu bytes of native code\n", compiled->native_size);
+    }
+    return stub_simulate(compiled->source, compiled->name);
+}
+
+int mp_embed_module_load(const char *name, mp_embed_compiled_t *compiled) {
+    int ret = mp_embed_exec_compiled(compiled);
+    if (ret != MP_EMBED_OK) {
+        return ret;
+    }
+    mp_embed_ctx_t *ctx = stub_ctx();
+    stub_script_module_t *module = stub_find_script_module(name, strlen(name));
+    if (!module) {
+        stub_script_module_t *modules = realloc(ctx->script_modules,
+                                                (ctx->n_script_modules + 1) * sizeof(*modules));
+        char *copy = strdup(name);
+        if (!modules || !copy) {
+            if (modules) {
+                ctx->script_modules = modules;
+            }
+            free(copy);
+            return stub_raise("MemoryError", "memory allocation failed");
+        }
+        ctx->script_modules = modules;
+        module = &modules[ctx->n_script_modules++];
+        module->name = copy;
+        module->generation = 0;
+    }
+    module->generation++;
+    stub_trace("MicroPython stub: sys.modules['%s'] bound (load %u)\n", name, module->generation);
+    return MP_EMBED_OK;
+}
+
+void mp_embed_free_compiled(mp_embed_compiled_t *compiled) {
+    if (compiled) {
+        if (compiled->native_code) {
+            stub_free_exec(compiled->ctx, compiled->native_code, compiled->native_size);
+        }
+        stub_gc_free(compiled->source);
+        stub_gc_free(compiled);
+    }
+}
+
+// Allocate every bytearray(N) of the script on the GC heap, keeping them
+// alive until the script ends like the locals of a real module would be
+static int stub_simulate_alloc(const char *code) {
+    stub_obj_t *live[16];
+    size_t n_live = 0;
+    int ret = MP_EMBED_OK;
+    for (const char *p = strstr(code, "bytearray("); p; p = strstr(p, "bytearray(")) {
+        p += 10;
+        size_t size = strtoul(p, NULL, 10);
+        stub_obj_t *obj = stub_obj_alloc(MP_EMBED_TYPE_STR, size + 1);
+        if (!obj) {
+            stub_raise("MemoryError", "memory allocation failed");
+            stub_print("Traceback (most recent call last):\nMemoryError: memory allocation failed\n");
+            ret = MP_EMBED_ERROR;
+            break;
+        }
+        obj->len = size;
+        obj->u.s = (char *)(obj + 1);
+        obj->u.s[size] = '\0';
+        if (n_live == sizeof(live) / sizeof(live[0])) {
+            stub_trace("MicroPython stub: bytearray %zu not kept alive\n", size);
+            continue;
+        }
+        obj->pins++;
+        live[n_live++] = obj;
+    }
+    for (size_t i = 0; i < n_live; i++) {
+        live[i]->pins--;
+    }
+    return ret;
+}
+
+// 1-based line of position in code
+static unsigned int stub_line_of(const char *code, const char *position) {
+    unsigned int line = 1;
+    for (const char *p = code; p < position; p++) {
+        line += *p == '\n';
+    }
+    return line;
+}
+
+// Start of the line holding position
+static const char *stub_line_start(const char *code, const char *position) {
+    while (position > code && position[-1] != '\n') {
+        position--;
+    }
+    return position;
+}
+
+// Report the call stack at position if a sample was requested. The stub
+// has no frames to walk: an indented position belongs to the function of
+// the enclosing unindented def, called from its first module-level call.
+static void stub_profile_poll(mp_embed_ctx_t *ctx, const char *code, const char *source_name, const char *position) {
+    if (!atomic_load(&ctx->profile_pending) || !atomic_exchange(&ctx->profile_pending, 0) || !ctx->sample_fn) {
+        return;
+    }
+    mp_embed_frame_t frames[2];
+    size_t depth = 0;
+    char function[64];
+    
+    // The last unindented line before position
+    const char *block = NULL;
+    const char *line = stub_line_start(code, position);
+    if (*line == ' ' || *line == '\t') {
+        while (line > code) {
+            line = stub_line_start(code, line - 1);
+            if (*line != ' ' && *line != '\t' && *line != '\n') {
+                block = line;
+                break;
+            }
+        }
+    }
+    if (block && strncmp(block, "def ", 4) == 0) {
+        size_t len = strcspn(block + 4, "(:\n");
+        if (len >= sizeof(function)) {
+            len = sizeof(function) - 1;
+        }
+        memcpy(function, block + 4, len);
+        function[len] = '\0';
+        frames[depth].function = function;
+        frames[depth].source = source_name;
+        frames[depth].line = stub_line_of(code, position);
+        depth++;
+        
+        position = block;
+        for (const char *call = strstr(block + 4 + len, function); call; call = strstr(call + len, function)) {
+            line = stub_line_start(code, call);
+            if (*line != ' ' && *line != '\t' && call[len] == '(') {
+                position = call;
+                break;
+            }
+        }
+    }
+    frames[depth].function = "<module>";
+    frames[depth].source = source_name;
+    frames[depth].line = stub_line_of(code, position);
+    depth++;
+    ctx->sample_fn(ctx->sample_data, frames, depth);
+}
+
+static int stub_simulate(const char *code, const char *source_name) {
+    stub_trace("MicroPython stub: executing code:\n%s\n", code);
+    mp_embed_ctx_t *ctx = stub_ctx();
+    stub_profile_poll(ctx, code, source_name, code);
+    
+    // An endless loop only ends when the VM is interrupted
+    const char *loop = strstr(code, "while True");
+    if (loop) {
+        while (!atomic_exchange(&ctx->interrupt_pending, 0)) {
+            stub_profile_poll(ctx, code, source_name, loop);
+            sched_yield();
+        }
+        stub_print("KeyboardInterrupt\n");
+        return MP_EMBED_INTERRUPTED;
+    }
     
     // Simple simulation of Python print statements
     if (strstr(code, "print(") != NULL) {
@@ -41,9 +1684,9 @@ int mp_embed_exec_str(const char *code) {
                     // Remove quotes if present
                     if (content[0] == '"' && content[len-1] == '"') {
                         content[len-1] = '\0';
-                        printf("%s\n", content + 1);
+                        stub_print("%s\n", content + 1);
                     } else {
-                        printf("%s\n", content);
+                        stub_print("%s\n", content);
                     }
                     free(content);
                 }
@@ -52,17 +1695,21 @@ int mp_embed_exec_str(const char *code) {
     }
     
     // Simulate other Python features
-    if (strstr(code, "import")) {
-        printf("MicroPython stub: import statement detected\n");
+    if (strstr(code, "import ")) {
+        stub_simulate_import(code);
     }
     
     if (strstr(code, "for ") && strstr(code, "range(")) {
-        printf("MicroPython stub: for loop with range detected\n");
+        stub_trace("MicroPython stub: for loop with range detected\n");
     }
     
     if (strstr(code, "def ")) {
-        printf("MicroPython stub: function definition detected\n");
+        stub_trace("MicroPython stub: function definition detected\n");
+    }
+    
+    if (strstr(code, "bytearray(")) {
+        return stub_simulate_alloc(code);
     }
     
-    return 0; // Success
+    return MP_EMBED_OK;
 }
@@ -0,0 +1,143 @@
+#include "module_watcher.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#define WATCHER_HAVE_INOTIFY 1
+#else
+#define WATCHER_HAVE_INOTIFY 0
+#endif
+
+namespace {
+
+// Module name of a .py file name, or an empty string for other files
+std::string moduleName(const char* file) {
+    size_t len = std::strlen(file);
+    if (len <= 3 || std::strcmp(file + len - 3, ".py") != 0 || file[0] == '.') {
+        return std::string();
+    }
+    return std::string(file, len - 3);
+}
+
+} // namespace
+
+// Start watching a directory
+bool ModuleWatcher::start(const std::string& directory, Handler handler, std::string& error) {
+    stop();
+#if WATCHER_HAVE_INOTIFY
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0) {
+        error = std::string("inotify_init1 failed: ") + std::strerror(errno);
+        return false;
+    }
+    if (inotify_add_watch(inotifyFd_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR) < 0) {
+        error = "Cannot watch " + directory + ": " + std::strerror(errno);
+        close(inotifyFd_);
+        inotifyFd_ = -1;
+        return false;
+    }
+    if (pipe2(stopFd_, O_CLOEXEC) != 0) {
+        error = std::string("pipe2 failed: ") + std::strerror(errno);
+        close(inotifyFd_);
+        inotifyFd_ = -1;
+        return false;
+    }
+    directory_ = directory;
+    handler_ = std::move(handler);
+    thread_ = std::thread(&ModuleWatcher::run, this);
+    return true;
+#else
+    (void)directory;
+    (void)handler;
+    error = "Watching modules requires inotify (Linux)";
+    return false;
+#endif
+}
+
+// Stop watching
+void ModuleWatcher::stop() {
+#if WATCHER_HAVE_INOTIFY
+    if (thread_.joinable()) {
+        char byte = 0;
+        ssize_t written = write(stopFd_[1], &byte, 1);
+        (void)written;
+        thread_.join();
+    }
+    for (int* fd : {&inotifyFd_, &stopFd_[0], &stopFd_[1]}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+#endif
+    handler_ = nullptr;
+}
+
+// List the modules in the watched directory
+std::vector<std::pair<std::string, std::string>> ModuleWatcher::modules() const {
+    std::vector<std::pair<std::string, std::string>> result;
+#if WATCHER_HAVE_INOTIFY
+    DIR* dir = opendir(directory_.c_str());
+    if (!dir) {
+        return result;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = moduleName(entry->d_name);
+        if (!name.empty()) {
+            result.emplace_back(name, directory_ + "/" + entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(result.begin(), result.end());
+#endif
+    return result;
+}
+
+void ModuleWatcher::notify(const char* file, Clock::time_point changed) {
+    std::string name = moduleName(file);
+    if (!name.empty()) {
+        handler_(name, directory_ + "/" + file, changed);
+    }
+}
+
+void ModuleWatcher::run() {
+#if WATCHER_HAVE_INOTIFY
+    alignas(struct inotify_event) char buffer[4096];
+    for (;;) {
+        struct pollfd fds[2] = {{inotifyFd_, POLLIN, 0}, {stopFd_[0], POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (fds[1].revents) {
+            return;
+        }
+        Clock::time_point changed = Clock::now();
+
+        // Drain every queued event first so a burst of writes to one file
+        // triggers a single reload
+        std::vector<std::string> files;
+        ssize_t len;
+        while ((len = read(inotifyFd_, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + len; ) {
+                const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+                if (event->len && std::find(files.begin(), files.end(), event->name) == files.end()) {
+                    files.emplace_back(event->name);
+                }
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        for (const std::string& file : files) {
+            notify(file.c_str(), changed);
+        }
+    }
+#endif
+}
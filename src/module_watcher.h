@@ -0,0 +1,73 @@
+#ifndef MODULE_WATCHER_H
+#define MODULE_WATCHER_H
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Watches a directory of Python modules with inotify
+ *
+ * One thread per watcher sleeps in poll() and reports every .py file that
+ * was written (closed after writing) or moved into the directory, e.g. by
+ * an atomic rename() deploy. Events read together are coalesced per file.
+ */
+class ModuleWatcher {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * Called on the watcher thread for each changed module
+     * @param name Module name (file name without .py)
+     * @param path Path of the file
+     * @param changed When the change was noticed
+     */
+    using Handler = std::function<void(const std::string& name, const std::string& path, Clock::time_point changed)>;
+
+    ModuleWatcher() = default;
+    ~ModuleWatcher() {
+        stop();
+    }
+
+    /**
+     * Start watching (stops a previous watch first)
+     * @param directory Directory holding the modules
+     * @param handler Receives changes
+     * @param error Receives the failure reason
+     * @return true on success; false where inotify is unavailable
+     */
+    bool start(const std::string& directory, Handler handler, std::string& error);
+
+    /**
+     * Stop watching and join the thread; must not be called from the handler
+     */
+    void stop();
+
+    bool active() const {
+        return thread_.joinable();
+    }
+
+    /**
+     * List the modules currently in the watched directory
+     * @return (name, path) pairs sorted by name
+     */
+    std::vector<std::pair<std::string, std::string>> modules() const;
+
+private:
+    void run();
+    void notify(const char* file, Clock::time_point changed);
+
+    std::string directory_;
+    Handler handler_;
+    int inotifyFd_ = -1;
+    int stopFd_[2] = {-1, -1};      // Pipe waking the thread up for stop()
+    std::thread thread_;
+
+    ModuleWatcher(const ModuleWatcher&) = delete;
+    ModuleWatcher& operator=(const ModuleWatcher&) = delete;
+};
+
+#endif // MODULE_WATCHER_H
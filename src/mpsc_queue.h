@@ -0,0 +1,88 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <memory>
+
+/**
+ * Base class for nodes stored in an MpscQueue
+ */
+struct MpscNode {
+    std::atomic<MpscNode*> next{nullptr};
+};
+
+/**
+ * Intrusive multi-producer single-consumer queue (Vyukov)
+ *
+ * push() is wait-free and may be called from any thread. pop() must only
+ * be called from the single consumer thread. pop() can transiently return
+ * nullptr while a producer is between its two steps; callers that need an
+ * exact emptiness check should keep their own counter.
+ */
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue()
+        : head_(&stub_), tail_(&stub_) {}
+
+    ~MpscQueue() {
+        while (pop()) {
+        }
+    }
+
+    /**
+     * Enqueue a node, taking ownership of it
+     * @param node Node to enqueue
+     */
+    void push(std::unique_ptr<T> node) {
+        pushNode(node.release());
+    }
+
+    /**
+     * Dequeue the oldest node (consumer thread only)
+     * @return Node, or nullptr if the queue looks empty
+     */
+    std::unique_ptr<T> pop() {
+        MpscNode* tail = tail_;
+        MpscNode* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &stub_) {
+            if (!next) {
+                return nullptr;
+            }
+            tail_ = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail_ = next;
+            return std::unique_ptr<T>(static_cast<T*>(tail));
+        }
+        if (tail != head_.load(std::memory_order_acquire)) {
+            // A producer has swapped head but not linked its node yet
+            return nullptr;
+        }
+        pushNode(&stub_);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next) {
+            tail_ = next;
+            return std::unique_ptr<T>(static_cast<T*>(tail));
+        }
+        return nullptr;
+    }
+
+private:
+    void pushNode(MpscNode* node) {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        MpscNode* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    std::atomic<MpscNode*> head_;   // Producers push here
+    MpscNode* tail_;                // Consumer pops here
+    MpscNode stub_;
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+};
+
+#endif // MPSC_QUEUE_H
@@ -0,0 +1,68 @@
+#include "micropython_output.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+RingBufferSink::RingBufferSink(size_t capacity)
+    : buffer_(new char[roundUpToPowerOfTwo(std::max<size_t>(capacity, 64))]),
+      mask_(roundUpToPowerOfTwo(std::max<size_t>(capacity, 64)) - 1) {
+}
+
+void RingBufferSink::write(const char* data, size_t len) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    if (len > mask_ + 1 - (head - tail)) {
+        dropped_.fetch_add(len, std::memory_order_relaxed);
+        return;
+    }
+
+    // Copy in up to two pieces around the end of the ring
+    size_t offset = head & mask_;
+    size_t first = std::min(len, mask_ + 1 - offset);
+    std::memcpy(buffer_.get() + offset, data, first);
+    std::memcpy(buffer_.get(), data + first, len - first);
+    head_.store(head + len, std::memory_order_release);
+}
+
+size_t RingBufferSink::read(char* out, size_t max) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t len = std::min(max, head - tail);
+
+    size_t offset = tail & mask_;
+    size_t first = std::min(len, mask_ + 1 - offset);
+    std::memcpy(out, buffer_.get() + offset, first);
+    std::memcpy(out + first, buffer_.get(), len - first);
+    tail_.store(tail + len, std::memory_order_release);
+    return len;
+}
+
+std::string RingBufferSink::drain() {
+    std::string output(size(), '\0');
+    output.resize(read(&output[0], output.size()));
+    return output;
+}
+
+size_t RingBufferSink::size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+}
+
+uint64_t RingBufferSink::dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+void StdoutSink::write(const char* data, size_t len) {
+    std::fwrite(data, 1, len, stdout);
+}
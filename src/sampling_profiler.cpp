@@ -0,0 +1,140 @@
+#include "sampling_profiler.h"
+#include <algorithm>
+
+namespace {
+
+// Room for a few hundred samples between two drains
+constexpr size_t RING_CAPACITY = 64 * 1024;
+
+constexpr std::chrono::microseconds MIN_INTERVAL{100};
+
+} // namespace
+
+ProfileSession::ProfileSession()
+    : interval_(std::chrono::milliseconds(1)), ring_(RING_CAPACITY) {
+}
+
+void ProfileSession::reset(std::chrono::microseconds interval) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    drain();
+    stacks_.clear();
+    samples_ = 0;
+    dropped_.store(0, std::memory_order_relaxed);
+    interval_ = std::max(interval, MIN_INTERVAL);
+}
+
+std::chrono::microseconds ProfileSession::interval() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return interval_;
+}
+
+void ProfileSession::record(const char* stack, size_t len) {
+    // The ring drops a line whole, so it never holds a partial sample
+    uint64_t lost = ring_.dropped();
+    ring_.write(stack, len);
+    if (ring_.dropped() != lost) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ProfileSession::setRunning(bool running) {
+    running_.store(running, std::memory_order_release);
+}
+
+void ProfileSession::drain() {
+    std::string lines = ring_.drain();
+    size_t start = 0;
+    while (start < lines.size()) {
+        size_t end = lines.find('\n', start);
+        if (end == std::string::npos) {
+            end = lines.size();
+        }
+        stacks_[lines.substr(start, end - start)]++;
+        samples_++;
+        start = end + 1;
+    }
+}
+
+std::string ProfileSession::folded() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    drain();
+    std::string result;
+    for (const auto& stack : stacks_) {
+        result += stack.first;
+        result += ' ';
+        result += std::to_string(stack.second);
+        result += '\n';
+    }
+    return result;
+}
+
+uint64_t ProfileSession::samples() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    drain();
+    return samples_;
+}
+
+uint64_t ProfileSession::dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+SamplingProfiler& SamplingProfiler::instance() {
+    static SamplingProfiler profiler;
+    return profiler;
+}
+
+SamplingProfiler::~SamplingProfiler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void SamplingProfiler::add(ProfileSession& session) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!thread_.joinable()) {
+        thread_ = std::thread(&SamplingProfiler::run, this);
+    }
+    session.due_ = Clock::now() + session.interval_;
+    sessions_.push_back(&session);
+    cv_.notify_one();
+}
+
+void SamplingProfiler::remove(ProfileSession& session) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sessions_.erase(std::remove(sessions_.begin(), sessions_.end(), &session), sessions_.end());
+}
+
+void SamplingProfiler::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        if (sessions_.empty()) {
+            cv_.wait(lock);
+            continue;
+        }
+        Clock::time_point now = Clock::now();
+        Clock::time_point next = Clock::time_point::max();
+        for (ProfileSession* session : sessions_) {
+            if (session->due_ <= now) {
+                if (session->running_.load(std::memory_order_acquire)) {
+                    session->request(session->data);
+                }
+                // Skip intervals missed while busy instead of bursting
+                session->due_ += session->interval_;
+                if (session->due_ <= now) {
+                    session->due_ = now + session->interval_;
+                }
+                if (session->ring_.size() > 0) {
+                    std::lock_guard<std::mutex> sessionLock(session->mutex_);
+                    session->drain();
+                }
+            }
+            next = std::min(next, session->due_);
+        }
+        cv_.wait_until(lock, next);
+    }
+}
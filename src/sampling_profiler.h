@@ -0,0 +1,131 @@
+#ifndef SAMPLING_PROFILER_H
+#define SAMPLING_PROFILER_H
+
+#include "micropython_output.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Samples of one engine; registered with SamplingProfiler::add()
+ *
+ * The thread running the engine's code records every sample as one folded
+ * stack line into a lock-free ring and never blocks; the profiler thread
+ * drains the ring and counts identical stacks.
+ */
+class ProfileSession {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    ProfileSession();
+
+    void (*request)(void* data) = nullptr;  // Asks the VM for a sample; runs on the profiler thread, must not block
+    void* data = nullptr;
+
+    /**
+     * Record a sample (thread running the code only)
+     * @param stack Frames outermost first, ';'-separated, ending with '\n'
+     * @param len Length of stack
+     */
+    void record(const char* stack, size_t len);
+
+    /**
+     * Tell whether the engine is running code; requests are only sent while it is
+     */
+    void setRunning(bool running);
+
+    /**
+     * Drop the samples and set the time between two sample requests
+     * Only while the session is not added to the profiler.
+     * @param interval Request interval, at least 100 us
+     */
+    void reset(std::chrono::microseconds interval);
+
+    /**
+     * Time between two sample requests
+     */
+    std::chrono::microseconds interval();
+
+    /**
+     * Aggregated samples in folded stack format, one "frame;frame count"
+     * line per distinct stack (input of flamegraph.pl and speedscope)
+     */
+    std::string folded();
+
+    /**
+     * Samples recorded so far
+     */
+    uint64_t samples();
+
+    /**
+     * Samples lost because the ring was full
+     */
+    uint64_t dropped() const;
+
+private:
+    friend class SamplingProfiler;
+
+    void drain();                           // Consumer side; mutex_ held
+
+    std::chrono::microseconds interval_;
+    Clock::time_point due_;                 // Next request (profiler thread)
+    std::atomic<bool> running_{false};
+    RingBufferSink ring_;                   // Folded stacks, one line per sample
+    std::atomic<uint64_t> dropped_{0};
+    std::mutex mutex_;                      // Serializes consumers of ring_; guards stacks_ and interval_
+    std::map<std::string, uint64_t> stacks_;
+    uint64_t samples_ = 0;
+
+    ProfileSession(const ProfileSession&) = delete;
+    ProfileSession& operator=(const ProfileSession&) = delete;
+};
+
+/**
+ * Process-wide sampling profiler: one thread requests the samples of every
+ * profiled engine at its interval
+ *
+ * Requests are only sent to engines that are running code, so an idle or
+ * unprofiled engine costs nothing.
+ */
+class SamplingProfiler {
+public:
+    static SamplingProfiler& instance();
+
+    /**
+     * Start requesting samples for a session
+     * @param session Session with request/data set; must stay alive until remove()
+     */
+    void add(ProfileSession& session);
+
+    /**
+     * Stop requesting samples; once this returns request() is not called again
+     * @param session Session passed to add()
+     */
+    void remove(ProfileSession& session);
+
+    ~SamplingProfiler();
+
+private:
+    using Clock = ProfileSession::Clock;
+
+    SamplingProfiler() = default;
+
+    void run();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<ProfileSession*> sessions_;
+    bool stop_ = false;
+    std::thread thread_;                    // Started by the first add()
+
+    SamplingProfiler(const SamplingProfiler&) = delete;
+    SamplingProfiler& operator=(const SamplingProfiler&) = delete;
+};
+
+#endif // SAMPLING_PROFILER_H
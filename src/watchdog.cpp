@@ -0,0 +1,113 @@
+#include "watchdog.h"
+#include <algorithm>
+
+Watchdog& Watchdog::instance() {
+    static Watchdog watchdog;
+    return watchdog;
+}
+
+Watchdog::Watchdog()
+    : wheel_(SLOTS, nullptr), epoch_(Clock::now()) {
+}
+
+Watchdog::~Watchdog() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+uint64_t Watchdog::tickAt(Clock::time_point time) const {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(time - epoch_) / TICK);
+}
+
+void Watchdog::arm(WatchdogTimer& timer, std::chrono::nanoseconds timeout) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!thread_.joinable()) {
+        thread_ = std::thread(&Watchdog::run, this);
+    }
+
+    // Round up so a timer never fires early; it must land in a slot the
+    // thread has not visited yet
+    uint64_t expiry = tickAt(Clock::now() + timeout) + 1;
+    timer.expiry = std::max(expiry, processed_ + 1);
+    WatchdogTimer*& head = wheel_[timer.expiry & (SLOTS - 1)];
+    timer.prev = nullptr;
+    timer.next = head;
+    if (head) {
+        head->prev = &timer;
+    }
+    head = &timer;
+    timer.armed = true;
+    armed_++;
+
+    if (timer.expiry < nextExpiry_) {
+        nextExpiry_ = timer.expiry;
+        cv_.notify_one();
+    }
+}
+
+void Watchdog::disarm(WatchdogTimer& timer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (timer.armed) {
+        unlink(timer);
+    }
+}
+
+void Watchdog::unlink(WatchdogTimer& timer) {
+    if (timer.prev) {
+        timer.prev->next = timer.next;
+    } else {
+        wheel_[timer.expiry & (SLOTS - 1)] = timer.next;
+    }
+    if (timer.next) {
+        timer.next->prev = timer.prev;
+    }
+    timer.prev = nullptr;
+    timer.next = nullptr;
+    timer.armed = false;
+    armed_--;
+}
+
+void Watchdog::expire(uint64_t now) {
+    // Visit every slot passed since the last wake-up once; timers further
+    // than one revolution away stay in their slot
+    uint64_t ticks = std::min<uint64_t>(now - processed_, SLOTS);
+    for (uint64_t i = 1; i <= ticks; i++) {
+        WatchdogTimer* timer = wheel_[(processed_ + i) & (SLOTS - 1)];
+        while (timer) {
+            WatchdogTimer* next = timer->next;
+            if (timer->expiry <= now) {
+                unlink(*timer);
+                timer->fire(timer->data);
+            }
+            timer = next;
+        }
+    }
+    processed_ = now;
+
+    nextExpiry_ = UINT64_MAX;
+    for (WatchdogTimer* timer : wheel_) {
+        for (; timer; timer = timer->next) {
+            nextExpiry_ = std::min(nextExpiry_, timer->expiry);
+        }
+    }
+}
+
+void Watchdog::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        if (armed_ == 0) {
+            cv_.wait(lock);
+            continue;
+        }
+        cv_.wait_until(lock, epoch_ + TICK * nextExpiry_);
+        if (!stop_) {
+            expire(tickAt(Clock::now()));
+        }
+    }
+}
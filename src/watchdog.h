@@ -0,0 +1,77 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Timer armed with Watchdog::arm(); owned (and kept alive) by the caller
+ */
+struct WatchdogTimer {
+    void (*fire)(void* data) = nullptr;     // Runs on the watchdog thread; must not block
+    void* data = nullptr;
+    uint64_t expiry = 0;                    // Tick the timer fires at
+    WatchdogTimer* prev = nullptr;          // Links within a wheel slot
+    WatchdogTimer* next = nullptr;
+    bool armed = false;
+};
+
+/**
+ * Process-wide watchdog: a single thread and one hashed timer wheel serve
+ * the execution deadlines of every engine
+ *
+ * arm() and disarm() are O(1) and never allocate. Timers fire with
+ * millisecond resolution; once disarm() has returned the timer's callback
+ * is guaranteed not to run.
+ */
+class Watchdog {
+public:
+    static Watchdog& instance();
+
+    /**
+     * Arm a timer (it must not be armed already)
+     * @param timer Timer with fire/data set
+     * @param timeout Time until it fires
+     */
+    void arm(WatchdogTimer& timer, std::chrono::nanoseconds timeout);
+
+    /**
+     * Disarm a timer; a no-op if it already fired
+     * @param timer Timer passed to arm()
+     */
+    void disarm(WatchdogTimer& timer);
+
+    ~Watchdog();
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t SLOTS = 256;    // Power of two
+    static constexpr std::chrono::milliseconds TICK{1};
+
+    Watchdog();
+
+    uint64_t tickAt(Clock::time_point time) const;
+    void unlink(WatchdogTimer& timer);
+    void expire(uint64_t now);
+    void run();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<WatchdogTimer*> wheel_;     // Slot list heads
+    Clock::time_point epoch_;
+    uint64_t processed_ = 0;                // Last tick whose slot was visited
+    uint64_t nextExpiry_ = UINT64_MAX;      // Earliest armed expiry (may be stale-early)
+    size_t armed_ = 0;
+    bool stop_ = false;
+    std::thread thread_;                    // Started by the first arm()
+
+    Watchdog(const Watchdog&) = delete;
+    Watchdog& operator=(const Watchdog&) = delete;
+};
+
+#endif // WATCHDOG_H
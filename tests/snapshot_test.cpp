@@ -0,0 +1,65 @@
+#include "micropython_engine.h"
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+/**
+ * Restore a snapshot written by the parent process and check its state
+ * @param path Snapshot image
+ * @return Process exit code
+ */
+int restore(const std::string& path) {
+    MicroPythonEngine engine;
+    if (!engine.initializeFromSnapshot(path)) {
+        std::cerr << "initializeFromSnapshot failed: " << engine.getLastError() << std::endl;
+        return 1;
+    }
+    if (engine.getHeapSize() != MicroPythonConfig().heap_size) {
+        std::cerr << "Restored heap has " << engine.getHeapSize() << " bytes" << std::endl;
+        return 1;
+    }
+    if (!engine.executeString("print(warm)")) {
+        std::cerr << "Execution after restore failed: " << engine.getLastError() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Save a snapshot of an engine with the default configuration and restore
+ * it in a fresh process (the heap address is still taken in this one)
+ */
+int main(int argc, char* argv[]) {
+    if (argc == 3 && std::strcmp(argv[1], "--restore") == 0) {
+        return restore(argv[2]);
+    }
+
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("snapshot_test_" + std::to_string(getpid()) + ".img")).string();
+    MicroPythonEngine engine;
+    if (!engine.initialize()) {
+        std::cerr << "initialize failed: " << engine.getLastError() << std::endl;
+        return 1;
+    }
+    if (!engine.executeString("warm = 41")) {
+        std::cerr << "Warm-up failed: " << engine.getLastError() << std::endl;
+        return 1;
+    }
+    if (!engine.saveSnapshot(path)) {
+        std::cerr << "saveSnapshot failed: " << engine.getLastError() << std::endl;
+        return 1;
+    }
+
+    std::string command = "\"" + std::string(argv[0]) + "\" --restore \"" + path + "\"";
+    int status = std::system(command.c_str());
+    std::filesystem::remove(path);
+    if (status != 0) {
+        std::cerr << "Restore in a new process failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Snapshot saved and restored with the default configuration" << std::endl;
+    return 0;
+}